@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "libindex.hpp"
+#include "logger.hpp"
+#include "packet.hpp"
+#include "mock_server.hpp"
+
+// Every allocation made by the benchmark thread is counted, so that allocations per operation can be reported.
+// Allocations made by the mock server's threads or the logger's writer thread are not part of what is measured.
+namespace
+{
+	thread_local bool count_allocations = false;
+	thread_local uint64_t allocation_count = 0;
+}
+
+void *operator new(size_t size)
+{
+	if (count_allocations) allocation_count++;
+	void *memory = std::malloc(size ? size : 1);
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+namespace
+{
+	using bench_clock = std::chrono::steady_clock;
+
+	typedef struct
+	{
+		std::string name;
+		/// The number of operations performed.
+		size_t operations;
+		double seconds;
+		/// The latency of each operation in microseconds, if the benchmark measures it.
+		std::vector<double> latencies;
+		uint64_t allocations;
+	} bench_result_t;
+
+	/**
+	 * @brief Runs `body` once with allocation counting enabled and records how long it took.
+	 * @param body Performs the benchmark and returns the number of operations it completed.
+	 */
+	bench_result_t measure(const std::string &name, std::vector<double> &latencies, const std::function<size_t()> &body)
+	{
+		bench_result_t result;
+		result.name = name;
+
+		allocation_count = 0;
+		count_allocations = true;
+		auto start = bench_clock::now();
+		result.operations = body();
+		auto end = bench_clock::now();
+		count_allocations = false;
+
+		result.seconds = std::chrono::duration<double>(end - start).count();
+		result.allocations = allocation_count;
+		result.latencies = std::move(latencies);
+		return result;
+	}
+
+	double percentile(std::vector<double> &sorted, double fraction)
+	{
+		if (sorted.empty()) return 0;
+		size_t index = std::min(sorted.size() - 1, (size_t) (fraction * sorted.size()));
+		return sorted[index];
+	}
+
+	void print_header()
+	{
+		printf("%-28s %10s %14s %12s %12s %12s\n", "benchmark", "ops", "ops/sec", "p50 (us)", "p99 (us)", "allocs/op");
+	}
+
+	void print_result(bench_result_t &result)
+	{
+		std::sort(result.latencies.begin(), result.latencies.end());
+		double rate = result.seconds > 0 ? result.operations / result.seconds : 0;
+		double allocations = result.operations ? (double) result.allocations / result.operations : 0;
+
+		if (result.latencies.empty())
+		{
+			printf("%-28s %10zu %14.0f %12s %12s %12.2f\n", result.name.c_str(), result.operations, rate, "-", "-", allocations);
+		}
+		else
+		{
+			printf("%-28s %10zu %14.0f %12.1f %12.1f %12.2f\n", result.name.c_str(), result.operations, rate,
+				   percentile(result.latencies, 0.5), percentile(result.latencies, 0.99), allocations);
+		}
+		fflush(stdout);
+	}
+
+	double elapsed_us(bench_clock::time_point since)
+	{
+		return std::chrono::duration<double, std::micro>(bench_clock::now() - since).count();
+	}
+
+	/// Connects and authenticates a session to the mock server, or returns `nullptr`.
+	std::unique_ptr<Rcon> open_session(const MockRconServer &server)
+	{
+		auto session = std::make_unique<Rcon>(rcon_addr_t{"127.0.0.1", server.port()});
+		session->set_log_level(LOG_LEVEL::WARNING);
+		session->connect();
+		std::string password = "password";
+		if (!session->is_connected() || !session->authenticate(password)) return nullptr;
+		return session;
+	}
+
+	/// Redirects stdout to /dev/null while a logger benchmark is running.
+	class SilenceStdout
+	{
+	private:
+		int _saved;
+
+	public:
+		SilenceStdout()
+		{
+			std::cout.flush();
+			fflush(stdout);
+			this->_saved = dup(STDOUT_FILENO);
+			int null_fd = open("/dev/null", O_WRONLY);
+			dup2(null_fd, STDOUT_FILENO);
+			::close(null_fd);
+		}
+
+		~SilenceStdout()
+		{
+			std::cout.flush();
+			dup2(this->_saved, STDOUT_FILENO);
+			::close(this->_saved);
+		}
+	};
+
+	bench_result_t bench_encode(size_t iterations)
+	{
+		std::string buffer;
+		buffer.reserve(MAX_PACKET_LENGTH);
+		std::string body(100, 'x');
+		std::vector<double> latencies;
+
+		return measure("packet.encode", latencies, [&]() {
+			for (size_t i = 0; i < iterations; i++)
+			{
+				buffer.clear();
+				append_packet(buffer, (int32_t) i, 2, body);
+			}
+			return iterations;
+		});
+	}
+
+	bench_result_t bench_decode(size_t iterations)
+	{
+		// One read's worth of pipelined responses.
+		const size_t packets_per_read = 64;
+		std::string stream;
+		for (size_t i = 0; i < packets_per_read; i++) append_packet(stream, (int32_t) i, 0, std::string(100, 'x'));
+
+		PacketFramer framer;
+		std::vector<double> latencies;
+		size_t rounds = std::max<size_t>(1, iterations / packets_per_read);
+
+		return measure("packet.decode", latencies, [&]() {
+			size_t decoded = 0;
+			for (size_t round = 0; round < rounds; round++)
+			{
+				size_t available;
+				char *buffer = framer.prepare(available);
+				memcpy(buffer, stream.data(), stream.size());
+				framer.commit(stream.size());
+
+				rcon_packet_t packet;
+				while (framer.next(packet)) decoded++;
+			}
+			return decoded;
+		});
+	}
+
+	bench_result_t bench_logger(size_t iterations, bool async)
+	{
+		Logger logger("   BENCH    ", LOG_LEVEL::INFO);
+		std::vector<double> latencies;
+		SilenceStdout silence;
+
+		if (async) Logger::start_async(8192, LOG_OVERFLOW::BLOCK);
+		bench_result_t result = measure(async ? "logger.async" : "logger.sync", latencies, [&]() {
+			for (size_t i = 0; i < iterations; i++) logger.info("Received a response from the remote RCON server.");
+			Logger::flush();
+			return iterations;
+		});
+		if (async) Logger::stop_async();
+		return result;
+	}
+
+	bench_result_t bench_auth(const MockRconServer &server, size_t iterations)
+	{
+		std::vector<double> latencies;
+		latencies.reserve(iterations);
+		std::string password = "password";
+
+		return measure("auth", latencies, [&]() {
+			size_t completed = 0;
+			for (size_t i = 0; i < iterations; i++)
+			{
+				auto start = bench_clock::now();
+				Rcon session({"127.0.0.1", server.port()});
+				session.set_log_level(LOG_LEVEL::WARNING);
+				session.connect();
+				if (!session.is_connected() || !session.authenticate(password)) continue;
+				latencies.push_back(elapsed_us(start));
+				completed++;
+			}
+			return completed;
+		});
+	}
+
+	bench_result_t bench_command(const std::string &name, const MockRconServer &server, const std::string &command, size_t iterations)
+	{
+		std::vector<double> latencies;
+		latencies.reserve(iterations);
+		std::unique_ptr<Rcon> session = open_session(server);
+		if (!session) return {name, 0, 0, {}, 0};
+
+		return measure(name, latencies, [&]() {
+			size_t completed = 0;
+			for (size_t i = 0; i < iterations; i++)
+			{
+				auto start = bench_clock::now();
+				std::string response = session->send_command(command);
+				if (response.empty()) continue;
+				latencies.push_back(elapsed_us(start));
+				completed++;
+			}
+			return completed;
+		});
+	}
+
+	bench_result_t bench_pipelined(const MockRconServer &server, size_t iterations, size_t window)
+	{
+		std::vector<double> latencies;
+		latencies.reserve(iterations);
+		std::unique_ptr<Rcon> session = open_session(server);
+		std::string name = "command.pipelined." + std::to_string(window);
+		if (!session) return {name, 0, 0, {}, 0};
+
+		return measure(name, latencies, [&]() {
+			size_t sent = 0;
+			size_t completed = 0;
+			while (completed < iterations && session->is_connected())
+			{
+				while (sent < iterations && session->pending_commands() < window)
+				{
+					auto start = bench_clock::now();
+					session->send_command_async("status", [&, start](bool success, std::string) {
+						if (!success) return;
+						latencies.push_back(elapsed_us(start));
+						completed++;
+					});
+					sent++;
+				}
+				if (!session->poll(std::chrono::milliseconds(1000)) || (sent == iterations && session->pending_commands() == 0)) break;
+			}
+			return completed;
+		});
+	}
+
+	bool selected(const std::vector<std::string> &filters, const std::string &name)
+	{
+		if (filters.empty()) return true;
+		for (const auto &filter : filters)
+		{
+			if (name.find(filter) != std::string::npos) return true;
+		}
+		return false;
+	}
+}
+
+std::string help_text =
+	"Usage: rcon-bench [-n ITERATIONS] [FILTER...]\n\n"
+
+	"	Runs the Cpp-RCON benchmarks against a mock RCON server on the loopback interface.\n"
+	"	Only benchmarks whose name contains one of the FILTERs are run.\n\n"
+
+	"Options:\n"
+	"  -n ITERATIONS   The number of commands sent by each network benchmark (default 20000).\n"
+	"                  Micro benchmarks run 50 times as many operations.\n"
+	"  -h, --help      Displays this help screen and exits.\n";
+
+int main(int argc, char *argv[])
+{
+	size_t iterations = 20000;
+	std::vector<std::string> filters;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "-h" || argument == "--help")
+		{
+			std::cout << help_text;
+			return 0;
+		}
+		if (argument == "-n" && i + 1 < argc)
+		{
+			iterations = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+			continue;
+		}
+		filters.push_back(argument);
+	}
+
+	MockRconServer server;
+	mock_config_t fragmented_config;
+	fragmented_config.fragment_size = 1000;
+	fragmented_config.coalesce = false;
+	MockRconServer fragmented_server(fragmented_config);
+
+	if (!server.start() || !fragmented_server.start())
+	{
+		std::cerr << "Failed to start the mock RCON server." << std::endl;
+		return 1;
+	}
+
+	typedef struct
+	{
+		std::string name;
+		std::function<bench_result_t()> run;
+	} bench_t;
+
+	std::vector<bench_t> benchmarks = {
+		{"packet.encode", [&] { return bench_encode(iterations * 50); }},
+		{"packet.decode", [&] { return bench_decode(iterations * 50); }},
+		{"logger.sync", [&] { return bench_logger(iterations * 5, false); }},
+		{"logger.async", [&] { return bench_logger(iterations * 5, true); }},
+		{"auth", [&] { return bench_auth(server, std::max<size_t>(1, iterations / 20)); }},
+		{"command", [&] { return bench_command("command", server, "status", iterations); }},
+		{"command.pipelined.64", [&] { return bench_pipelined(server, iterations * 5, 64); }},
+		{"response.64k", [&] { return bench_command("response.64k", server, "bytes 65536", std::max<size_t>(1, iterations / 20)); }},
+		{"response.64k.fragmented", [&] { return bench_command("response.64k.fragmented", fragmented_server, "bytes 65536", std::max<size_t>(1, iterations / 20)); }},
+	};
+
+	print_header();
+	for (auto &benchmark : benchmarks)
+	{
+		if (!selected(filters, benchmark.name)) continue;
+		bench_result_t result = benchmark.run();
+		print_result(result);
+	}
+
+	server.stop();
+	fragmented_server.stop();
+	return 0;
+}
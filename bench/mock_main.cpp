@@ -0,0 +1,67 @@
+#include <csignal>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+#include "mock_server.hpp"
+
+namespace po = boost::program_options;
+
+std::string help_text =
+	"Usage: rcon-mock [OPTIONS]\n\n"
+
+	"	Runs a mock RCON server on 127.0.0.1 until interrupted.\n"
+	"	Commands are echoed back unless a response size is set. \"bytes N\", \"sleep MS\" and\n"
+	"	\"echo TEXT\" can be used to script individual responses, and \"push N\" sends N\n"
+	"	unsolicited packets with ID 0 before an empty response.\n\n";
+
+int main(int argc, char *argv[])
+{
+	mock_config_t config;
+	uint16_t port;
+	long delay_us;
+
+	po::options_description ops_desc("Options");
+	ops_desc.add_options()
+		("help,h", "Displays this help screen and exits.")
+		("port,p", po::value<uint16_t>(&port)->default_value(27015), "The port to listen on.")
+		("password,P", po::value<std::string>(&config.password)->default_value("password"), "The password clients have to authenticate with.")
+		("response-size,s", po::value<size_t>(&config.response_size)->default_value(0), "The size of every response. 0 echoes commands back.")
+		("fragment,f", po::value<size_t>(&config.fragment_size)->default_value(0), "Split writes into chunks of at most this many bytes.")
+		("delay,d", po::value<long>(&delay_us)->default_value(0), "Microseconds to wait before answering each command.")
+		("no-coalesce", "Send each packet of a response in its own write.")
+		("no-sentinel", "Don't echo empty SERVERDATA_RESPONSE_VALUE packets.")
+		("no-trailer", "Don't follow echoed sentinels with the extra packet that Source servers send.");
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, ops_desc), vm);
+	po::notify(vm);
+
+	if (vm.count("help")) {
+		std::cout << help_text << ops_desc << std::endl;
+		return 0;
+	}
+
+	config.delay = std::chrono::microseconds(delay_us);
+	config.coalesce = !vm.count("no-coalesce");
+	config.echo_sentinel = !vm.count("no-sentinel");
+	config.source_trailer = !vm.count("no-trailer");
+
+	// Block the signals before any threads are started, so they are only ever delivered to sigwait below.
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+	MockRconServer server(config);
+	if (!server.start(port)) {
+		std::cerr << "Failed to listen on port " << port << std::endl;
+		return 1;
+	}
+	std::cout << "Listening on 127.0.0.1:" << server.port() << std::endl;
+
+	int signal;
+	sigwait(&signals, &signal);
+
+	server.stop();
+}
@@ -0,0 +1,236 @@
+#include "mock_server.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+	constexpr int32_t SERVERDATA_AUTH = 3;
+	constexpr int32_t SERVERDATA_EXECCOMMAND = 2;
+	constexpr int32_t SERVERDATA_AUTH_RESPONSE = 2;
+	constexpr int32_t SERVERDATA_RESPONSE_VALUE = 0;
+}
+
+bool MockRconServer::start(uint16_t port)
+{
+	this->_listen_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (this->_listen_socket < 0) return false;
+
+	int reuse = 1;
+	setsockopt(this->_listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	socklen_t length = sizeof(address);
+	if (bind(this->_listen_socket, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+		listen(this->_listen_socket, SOMAXCONN) != 0 ||
+		getsockname(this->_listen_socket, (struct sockaddr *) &address, &length) != 0)
+	{
+		::close(this->_listen_socket);
+		this->_listen_socket = -1;
+		return false;
+	}
+
+	this->_port = ntohs(address.sin_port);
+	this->_running = true;
+	this->_accept_thread = std::thread(&MockRconServer::_accept_loop, this);
+	return true;
+}
+
+void MockRconServer::stop()
+{
+	if (!this->_running.exchange(false)) return;
+
+	// Shutting the sockets down wakes up every thread blocked on them.
+	shutdown(this->_listen_socket, SHUT_RDWR);
+	{
+		std::lock_guard<std::mutex> lock(this->_clients_mutex);
+		for (auto &client : this->_clients) shutdown(client.socket, SHUT_RDWR);
+	}
+	this->_accept_thread.join();
+
+	for (auto &client : this->_clients)
+	{
+		client.thread.join();
+		::close(client.socket);
+	}
+	this->_clients.clear();
+	::close(this->_listen_socket);
+	this->_listen_socket = -1;
+}
+
+void MockRconServer::_accept_loop()
+{
+	while (this->_running)
+	{
+		int client_socket = accept4(this->_listen_socket, nullptr, nullptr, SOCK_CLOEXEC);
+		if (client_socket < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			return;
+		}
+
+		int no_delay = 1;
+		setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+		this->_reap_clients();
+		std::lock_guard<std::mutex> lock(this->_clients_mutex);
+		if (!this->_running)
+		{
+			::close(client_socket);
+			return;
+		}
+		client_t &client = this->_clients.emplace_back();
+		client.socket = client_socket;
+		client.thread = std::thread(&MockRconServer::_serve, this, std::ref(client));
+	}
+}
+
+void MockRconServer::_reap_clients()
+{
+	std::lock_guard<std::mutex> lock(this->_clients_mutex);
+	for (auto it = this->_clients.begin(); it != this->_clients.end();)
+	{
+		if (!it->finished)
+		{
+			++it;
+			continue;
+		}
+		it->thread.join();
+		::close(it->socket);
+		it = this->_clients.erase(it);
+	}
+}
+
+void MockRconServer::_serve(client_t &client)
+{
+	int client_socket = client.socket;
+	PacketFramer framer;
+	std::string output;
+	bool authenticated = false;
+
+	while (this->_running)
+	{
+		size_t available;
+		char *buffer = framer.prepare(available);
+		ssize_t received = recv(client_socket, buffer, available, 0);
+		if (received <= 0)
+		{
+			if (received < 0 && errno == EINTR) continue;
+			break;
+		}
+		framer.commit(received);
+
+		// Everything that was requested in one read is answered together, so pipelined requests get pipelined responses.
+		output.clear();
+		rcon_packet_t request;
+		while (framer.next(request)) this->_answer(output, request, authenticated);
+		if (framer.is_corrupt() || !this->_send(client_socket, output)) break;
+	}
+	shutdown(client_socket, SHUT_RDWR);
+
+	std::lock_guard<std::mutex> lock(this->_clients_mutex);
+	client.finished = true;
+}
+
+void MockRconServer::_answer(std::string &output, const rcon_packet_t &request, bool &authenticated)
+{
+	if (request.type == SERVERDATA_AUTH)
+	{
+		authenticated = request.body == this->_config.password;
+		append_packet(output, request.id, SERVERDATA_RESPONSE_VALUE, "");
+		append_packet(output, authenticated ? request.id : -1, SERVERDATA_AUTH_RESPONSE, "");
+		return;
+	}
+
+	if (request.type == SERVERDATA_RESPONSE_VALUE)
+	{
+		if (!this->_config.echo_sentinel) return;
+		append_packet(output, request.id, SERVERDATA_RESPONSE_VALUE, "");
+		if (this->_config.source_trailer) append_packet(output, request.id, SERVERDATA_RESPONSE_VALUE, std::string_view("\x00\x01\x00\x00", 4));
+		return;
+	}
+
+	if (request.type != SERVERDATA_EXECCOMMAND || !authenticated) return;
+
+	if (this->_config.delay.count() > 0) std::this_thread::sleep_for(this->_config.delay);
+
+	std::string_view command = request.body;
+	std::string body;
+	if (command.substr(0, 6) == "bytes ")
+	{
+		body.assign(strtoul(std::string(command.substr(6)).c_str(), nullptr, 10), 'x');
+	}
+	else if (command.substr(0, 6) == "sleep ")
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(strtoul(std::string(command.substr(6)).c_str(), nullptr, 10)));
+	}
+	else if (command.substr(0, 5) == "echo ")
+	{
+		body.assign(command.substr(5));
+	}
+	else if (command.substr(0, 5) == "push ")
+	{
+		// Events that a server pushes on its own, like chat messages, carry an ID that no request used.
+		unsigned long count = strtoul(std::string(command.substr(5)).c_str(), nullptr, 10);
+		for (unsigned long i = 0; i < count; i++) append_packet(output, 0, SERVERDATA_RESPONSE_VALUE, "event " + std::to_string(i));
+	}
+	else if (this->_config.response_size > 0)
+	{
+		body.assign(this->_config.response_size, 'x');
+	}
+	else
+	{
+		body.assign(command);
+	}
+
+	// Long responses are split over several packets, the same way game servers split them.
+	std::string_view remaining = body;
+	do {
+		std::string_view chunk = remaining.substr(0, MAX_PACKET_LENGTH);
+		append_packet(output, request.id, SERVERDATA_RESPONSE_VALUE, chunk);
+		remaining.remove_prefix(chunk.size());
+	} while (!remaining.empty());
+}
+
+bool MockRconServer::_send(int client_socket, std::string_view packets)
+{
+	if (this->_config.coalesce) return this->_write(client_socket, packets);
+
+	while (!packets.empty())
+	{
+		int32_t size;
+		memcpy(&size, packets.data(), sizeof(size));
+		if (!this->_write(client_socket, packets.substr(0, sizeof(size) + size))) return false;
+		packets.remove_prefix(sizeof(size) + size);
+	}
+	return true;
+}
+
+bool MockRconServer::_write(int client_socket, std::string_view data)
+{
+	size_t step = this->_config.fragment_size > 0 ? this->_config.fragment_size : data.size();
+	while (!data.empty())
+	{
+		ssize_t sent = send(client_socket, data.data(), std::min(step, data.size()), MSG_NOSIGNAL);
+		if (sent < 0)
+		{
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data.remove_prefix(sent);
+	}
+	return true;
+}
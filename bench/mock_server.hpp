@@ -0,0 +1,103 @@
+#pragma once
+#ifndef _CPP_RCON_MOCK_SERVER_
+#define _CPP_RCON_MOCK_SERVER_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "packet.hpp"
+
+/**
+ * @brief How a @ref MockRconServer answers its clients.
+ */
+typedef struct
+{
+	/// The password that auth requests have to match.
+	std::string password = "password";
+	/// The size of the response to every command that doesn't ask for a size itself. 0 echoes the command back.
+	size_t response_size = 0;
+	/// Writes are split into chunks of at most this many bytes, so packets arrive in pieces. 0 disables this.
+	size_t fragment_size = 0;
+	/// How long to wait before answering each command.
+	std::chrono::microseconds delay{0};
+	/// Whether every packet of a response is sent in a single write, or each packet in its own write.
+	bool coalesce = true;
+	/// Whether empty `SERVERDATA_RESPONSE_VALUE` packets are echoed back, like Source servers do.
+	bool echo_sentinel = true;
+	/// Whether an echoed sentinel is followed by a second packet under the same ID with the body `00 01 00 00`, like
+	/// Source servers do.
+	bool source_trailer = true;
+} mock_config_t;
+
+/**
+ * @brief A small RCON server on the loopback interface, for benchmarks and manual testing.
+ *
+ * Each client is served by its own thread using blocking I/O, so the server stays out of the way of whatever
+ * is being measured on the client side. Responses longer than @ref MAX_PACKET_LENGTH are split over several packets.
+ *
+ * Apart from the settings in @ref mock_config_t, commands can script individual responses:
+ * - `bytes N` answers with N bytes.
+ * - `sleep MS` waits MS milliseconds before answering with an empty response.
+ * - `echo TEXT` answers with TEXT.
+ */
+class MockRconServer
+{
+private:
+	struct client_t
+	{
+		int socket;
+		std::thread thread;
+		/// Set by the client's thread once it has stopped serving, so the thread can be joined.
+		bool finished = false;
+	};
+
+	mock_config_t _config;
+	int _listen_socket = -1;
+	uint16_t _port = 0;
+	std::atomic<bool> _running{false};
+	std::thread _accept_thread;
+	std::mutex _clients_mutex;
+	std::list<client_t> _clients;
+
+	void _accept_loop();
+	/// Joins the threads of every client that has disconnected and closes their sockets.
+	void _reap_clients();
+	void _serve(client_t &client);
+	/// Builds every packet that answers a single request.
+	void _answer(std::string &output, const rcon_packet_t &request, bool &authenticated);
+	/// Sends a sequence of encoded packets, honouring @ref mock_config_t::coalesce.
+	bool _send(int client_socket, std::string_view packets);
+	/// Writes `data`, honouring @ref mock_config_t::fragment_size.
+	bool _write(int client_socket, std::string_view data);
+
+public:
+	MockRconServer(mock_config_t config = mock_config_t()) : _config(std::move(config)){};
+	~MockRconServer() { this->stop(); }
+
+	MockRconServer(const MockRconServer &) = delete;
+	MockRconServer &operator=(const MockRconServer &) = delete;
+
+	/**
+	 * @brief Starts listening on 127.0.0.1.
+	 * @param port The port to listen on. 0 picks a free one, see @ref port.
+	 * @returns False if the socket could not be set up.
+	 */
+	bool start(uint16_t port = 0);
+
+	/**
+	 * @brief Disconnects every client and stops listening.
+	 */
+	void stop();
+
+	/// The port the server is listening on.
+	uint16_t port() const { return this->_port; }
+};
+
+#endif // _CPP_RCON_MOCK_SERVER_
@@ -0,0 +1,115 @@
+#pragma once
+#ifndef _CPP_RCON_CACHE_
+#define _CPP_RCON_CACHE_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "libindex.hpp"
+
+/**
+ * @brief Counters kept by a @ref BasicRconCache.
+ */
+typedef struct
+{
+	/// Commands answered from the cache.
+	uint64_t hits;
+	/// Cacheable commands that had to be sent to the server.
+	uint64_t misses;
+	/// Cacheable commands that were attached to an identical command that was already in flight.
+	uint64_t coalesced;
+	/// Commands that aren't cacheable and were passed straight through.
+	uint64_t bypassed;
+} cache_stats_t;
+
+/**
+ * @brief An opt-in response cache for read-only commands sent on a session.
+ *
+ * Only commands that have been allowed with @ref allow are cached, each for its own TTL. Commands are matched exactly,
+ * so `status` and `status ` are different commands. While a cacheable command is in flight, identical commands are
+ * attached to it instead of being sent again, so a burst of the same query costs the server a single command.
+ * Failed commands are never cached.
+ *
+ * The cache must outlive every command sent through it, or the session must be closed first.
+ *
+ * @tparam Dialect The protocol dialect the server speaks. Use @ref RconCache for Source servers.
+ */
+template <typename Dialect>
+class BasicRconCache
+{
+public:
+	using Session = BasicRcon<Dialect>;
+	using CommandCallback = typename Session::CommandCallback;
+
+private:
+	typedef struct
+	{
+		std::string response;
+		/// New entries start out expired.
+		std::chrono::steady_clock::time_point expires;
+		/// Set while the command is being fetched from the server.
+		bool in_flight = false;
+		/// Everyone waiting for the command that is in flight.
+		std::vector<CommandCallback> waiters;
+	} entry_t;
+
+	Session &_session;
+	/// The TTL of every cacheable command.
+	std::unordered_map<std::string, std::chrono::milliseconds> _allowed;
+	std::unordered_map<std::string, entry_t> _entries;
+	cache_stats_t _stats{0, 0, 0, 0};
+
+	/// Stores the result of a fetched command and completes everyone waiting for it.
+	void _complete(const std::string &command, bool success, std::string response);
+
+public:
+	BasicRconCache(Session &session) : _session(session){};
+
+	BasicRconCache(const BasicRconCache &) = delete;
+	BasicRconCache &operator=(const BasicRconCache &) = delete;
+
+	/**
+	 * @brief Makes a command cacheable, or changes its TTL.
+	 * @param ttl How long a response stays valid after it has been received.
+	 */
+	void allow(const std::string &command, std::chrono::milliseconds ttl) { this->_allowed[command] = ttl; }
+
+	/**
+	 * @brief Stops caching a command and drops its cached response.
+	 */
+	void disallow(const std::string &command);
+
+	/**
+	 * @brief Drops every cached response, so the next request of each command goes to the server.
+	 */
+	void invalidate();
+
+	/**
+	 * @brief Same as @ref BasicRcon::send_command_async, but cacheable commands are answered from the cache when possible.
+	 * Cache hits run the callback straight away, before this returns.
+	 */
+	void send_command_async(const std::string &command, CommandCallback callback);
+
+	/**
+	 * @brief Same as @ref BasicRcon::send_command, but cacheable commands are answered from the cache when possible.
+	 */
+	std::string send_command(const std::string &command);
+
+	/// A copy of the cache's counters.
+	cache_stats_t stats() const { return this->_stats; }
+
+	/// The session the cache sends commands on.
+	Session &session() { return this->_session; }
+};
+
+/// A response cache for a session with a server that speaks the original Source dialect.
+using RconCache = BasicRconCache<SourceDialect>;
+
+#define CPP_RCON_DECLARE_CACHE(dialect) extern template class BasicRconCache<dialect>;
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DECLARE_CACHE)
+#undef CPP_RCON_DECLARE_CACHE
+
+#endif // _CPP_RCON_CACHE_
@@ -0,0 +1,125 @@
+#pragma once
+#ifndef _CPP_RCON_CONCURRENT_
+#define _CPP_RCON_CONCURRENT_
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+
+#include "libindex.hpp"
+#include "mpsc_queue.hpp"
+#include "reactor.hpp"
+
+/**
+ * @brief A session that any number of threads can send commands through at once.
+ *
+ * The session itself is owned by an I/O thread that drives it on an @ref RconReactor of its own. Other threads hand
+ * their commands over through a lock-free queue and get woken up through an `eventfd`, so submitting a command never
+ * takes a lock. Everything that was queued by the time the I/O thread wakes up is encoded and written in one go,
+ * pipelined behind whatever is already in flight, and every caller gets the response to its own command.
+ *
+ * @tparam Dialect The protocol dialect the server speaks. Use @ref ConcurrentRcon for Source servers.
+ */
+template <typename Dialect>
+class BasicConcurrentRcon
+{
+public:
+	using Session = BasicRcon<Dialect>;
+	using PACKET_TYPE = typename Session::PACKET_TYPE;
+	using CommandCallback = typename Session::CommandCallback;
+
+private:
+	typedef struct
+	{
+		std::string command;
+		PACKET_TYPE type;
+		CommandCallback callback;
+	} submission_t;
+
+	std::unique_ptr<Logger> _logger;
+	Session _session;
+	RconReactor _reactor;
+	std::thread _io_thread;
+	MpscQueue<submission_t> _submissions;
+	/// Written to wake the I/O thread up.
+	int _wakeup_fd = -1;
+	/// Set from the first submission after the I/O thread last looked at the queue until it looks again, so that a
+	/// burst of submissions only wakes it up once.
+	std::atomic<bool> _wakeup_pending{false};
+	/// Set while the I/O thread is accepting commands.
+	std::atomic<bool> _running{false};
+	std::atomic<bool> _stopping{false};
+	/// The number of threads inside @ref send_command_async. @ref _stop waits for them before failing what is left.
+	std::atomic<size_t> _submitters{0};
+
+	/// The body of the I/O thread. Drives the session until @ref _stopping is set, then closes it.
+	void _run(std::string password, std::promise<bool> ready);
+	/// Wakes the I/O thread up, unless a wakeup is already pending.
+	void _wake();
+	/// Sends everything that has been queued. Runs on the I/O thread.
+	void _drain();
+	/// Stops and joins the I/O thread, then fails whatever is still queued.
+	void _stop();
+
+public:
+	/**
+	 * @param addr The server to connect to.
+	 * @param backend How the I/O thread's reactor drives the socket.
+	 */
+	BasicConcurrentRcon(rcon_addr_t addr, REACTOR_BACKEND backend = REACTOR_BACKEND::AUTO);
+	/// Stops the I/O thread and closes the session. Commands that haven't completed yet fail.
+	~BasicConcurrentRcon();
+
+	BasicConcurrentRcon(const BasicConcurrentRcon &) = delete;
+	BasicConcurrentRcon &operator=(const BasicConcurrentRcon &) = delete;
+
+	/**
+	 * @brief The underlying session, for configuring it (timeouts, reconnect policy, log level, event subscriptions, ...) before
+	 * @ref start. Once started, it may only be touched from callbacks, which run on the I/O thread.
+	 */
+	Session &session() { return this->_session; }
+
+	/**
+	 * @brief Starts the I/O thread, which connects and authenticates, and blocks until it is done.
+	 * @returns Whether the session is ready for commands. If not, the I/O thread has been stopped again.
+	 */
+	bool start(const std::string &password);
+
+	/**
+	 * @brief Queues a command without waiting for its response. Safe to call from any thread.
+	 * @param callback Called on the I/O thread once the command has completed, so it must not block.
+	 */
+	void send_command_async(const std::string &command, CommandCallback callback, PACKET_TYPE type = PACKET_TYPE::SERVERDATA_EXECCOMMAND);
+
+	/**
+	 * @brief Same as the callback version of @ref send_command_async, but returns a future instead.
+	 * An empty string is returned through the future if the command failed.
+	 */
+	std::future<std::string> send_command_async(const std::string &command, PACKET_TYPE type = PACKET_TYPE::SERVERDATA_EXECCOMMAND);
+
+	/**
+	 * @brief Sends a command and blocks the calling thread until its response has arrived. Safe to call from any
+	 * thread except the I/O thread.
+	 * @returns The response, or an empty string if the command failed.
+	 */
+	std::string send_command(const std::string &command, PACKET_TYPE type = PACKET_TYPE::SERVERDATA_EXECCOMMAND);
+
+	/**
+	 * @brief The session's counters and latency histograms. Reading them is safe from any thread.
+	 */
+	const RconMetrics &metrics() const { return this->_session.metrics(); }
+
+	/// The backend the I/O thread's reactor uses.
+	REACTOR_BACKEND backend() const { return this->_reactor.backend(); }
+};
+
+/// A concurrent session with a server that speaks the original Source dialect.
+using ConcurrentRcon = BasicConcurrentRcon<SourceDialect>;
+
+#define CPP_RCON_DECLARE_CONCURRENT(dialect) extern template class BasicConcurrentRcon<dialect>;
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DECLARE_CONCURRENT)
+#undef CPP_RCON_DECLARE_CONCURRENT
+
+#endif // _CPP_RCON_CONCURRENT_
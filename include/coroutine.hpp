@@ -0,0 +1,300 @@
+#pragma once
+#ifndef _CPP_RCON_COROUTINE_
+#define _CPP_RCON_COROUTINE_
+
+#if __cplusplus < 202002L || !__has_include(<coroutine>)
+#error "coroutine.hpp requires C++20 coroutine support. Configure with -DCPP_RCON_COROUTINES=ON."
+#endif
+
+#include <coroutine>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libindex.hpp"
+#include "reactor.hpp"
+
+template <typename T>
+class RconTask;
+
+namespace rcon_detail
+{
+	/**
+	 * @brief Resumes whichever coroutine awaited a task once that task has finished.
+	 */
+	struct final_awaiter
+	{
+		bool await_ready() const noexcept { return false; }
+
+		template <typename Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+		{
+			std::coroutine_handle<> continuation = handle.promise().continuation;
+			return continuation ? continuation : std::noop_coroutine();
+		}
+
+		void await_resume() const noexcept {}
+	};
+
+	struct promise_base
+	{
+		std::coroutine_handle<> continuation;
+		std::exception_ptr exception;
+
+		std::suspend_always initial_suspend() const noexcept { return {}; }
+		final_awaiter final_suspend() const noexcept { return {}; }
+		void unhandled_exception() { this->exception = std::current_exception(); }
+	};
+
+	template <typename T>
+	struct promise : promise_base
+	{
+		std::optional<T> value;
+
+		RconTask<T> get_return_object();
+		void return_value(T result) { this->value = std::move(result); }
+
+		T result()
+		{
+			if (this->exception) std::rethrow_exception(this->exception);
+			return std::move(*this->value);
+		}
+	};
+
+	template <>
+	struct promise<void> : promise_base
+	{
+		RconTask<void> get_return_object();
+		void return_void() const noexcept {}
+
+		void result()
+		{
+			if (this->exception) std::rethrow_exception(this->exception);
+		}
+	};
+}
+
+/**
+ * @brief A lazily started coroutine that produces a `T`.
+ *
+ * A task doesn't run until it is either awaited by another coroutine or handed to @ref RconExecutor::spawn.
+ * @tparam T The type of the value the coroutine `co_return`s.
+ */
+template <typename T = void>
+class RconTask
+{
+public:
+	using promise_type = rcon_detail::promise<T>;
+
+private:
+	std::coroutine_handle<promise_type> _handle;
+
+public:
+	explicit RconTask(std::coroutine_handle<promise_type> handle) : _handle(handle){};
+	RconTask(RconTask &&other) noexcept : _handle(std::exchange(other._handle, nullptr)){};
+	RconTask &operator=(RconTask &&other) noexcept
+	{
+		if (this != &other)
+		{
+			if (this->_handle) this->_handle.destroy();
+			this->_handle = std::exchange(other._handle, nullptr);
+		}
+		return *this;
+	}
+	RconTask(const RconTask &) = delete;
+	RconTask &operator=(const RconTask &) = delete;
+	~RconTask()
+	{
+		if (this->_handle) this->_handle.destroy();
+	}
+
+	/// Whether the coroutine has run to completion.
+	bool done() const { return !this->_handle || this->_handle.done(); }
+
+	/// The underlying coroutine. Used by @ref RconExecutor to start the task.
+	std::coroutine_handle<promise_type> handle() const { return this->_handle; }
+
+	bool await_ready() const noexcept { return this->done(); }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+	{
+		this->_handle.promise().continuation = awaiting;
+		return this->_handle;
+	}
+
+	T await_resume() { return this->_handle.promise().result(); }
+};
+
+template <typename T>
+RconTask<T> rcon_detail::promise<T>::get_return_object()
+{
+	return RconTask<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline RconTask<void> rcon_detail::promise<void>::get_return_object()
+{
+	return RconTask<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+/**
+ * @brief A minimal single threaded executor for coroutines that talk to RCON servers.
+ *
+ * All I/O is driven by an @ref RconReactor. When an operation completes, the coroutine waiting on it is queued
+ * and resumed once the reactor has finished handling the current round of events, so coroutines never run
+ * from inside a session's callbacks.
+ */
+class RconExecutor
+{
+private:
+	RconReactor &_reactor;
+	std::vector<RconTask<void>> _tasks;
+	std::deque<std::coroutine_handle<>> _ready;
+
+	/// Resumes every queued coroutine, including any that become ready while doing so.
+	void _resume_ready();
+
+public:
+	RconExecutor(RconReactor &reactor) : _reactor(reactor){};
+	/// Destroys every task that is still running. Operations they were waiting on complete without resuming them.
+	~RconExecutor();
+
+	RconExecutor(const RconExecutor &) = delete;
+	RconExecutor &operator=(const RconExecutor &) = delete;
+
+	RconReactor &reactor() { return this->_reactor; }
+
+	/**
+	 * @brief Takes ownership of a task and starts running it.
+	 */
+	void spawn(RconTask<void> task);
+
+	/**
+	 * @brief Queues a suspended coroutine to be resumed by the executor.
+	 */
+	void schedule(std::coroutine_handle<> handle) { this->_ready.push_back(handle); }
+
+	/**
+	 * @brief Runs the reactor until every spawned task has finished.
+	 * @throws Whatever a spawned task finished with. See @ref run_once.
+	 */
+	void run();
+
+	/**
+	 * @brief Handles one round of events and resumes every coroutine that became ready.
+	 * @throws The exception a spawned task finished with, if any did. The task is gone afterwards, and the executor
+	 * can keep running the others. If several tasks failed, each further call rethrows the next exception.
+	 * @returns The number of tasks that are still running.
+	 */
+	size_t run_once(std::chrono::milliseconds timeout);
+};
+
+/**
+ * @brief Wraps a session so that connecting, authenticating and sending commands can be `co_await`ed.
+ *
+ * ```
+ * RconTask<> script(AwaitableRcon session)
+ * {
+ *     if (!co_await session.connect() || !co_await session.authenticate("password")) co_return;
+ *     std::string out = co_await session.command("status");
+ * }
+ * ```
+ * The session must outlive every operation started through this wrapper. A task that is destroyed while it waits on an
+ * operation, for instance along with its executor, is detached from it and never resumed.
+ *
+ * @tparam Dialect The protocol dialect the server speaks. Use @ref AwaitableRcon for Source servers.
+ */
+template <typename Dialect>
+class BasicAwaitableRcon
+{
+public:
+	using Session = BasicRcon<Dialect>;
+
+private:
+	Session &_session;
+	RconExecutor &_executor;
+
+public:
+	/**
+	 * @brief Awaits a session operation that is started with a callback, and resumes with its result.
+	 * @tparam Result What the `co_await` expression evaluates to.
+	 */
+	template <typename Result>
+	class Operation
+	{
+	private:
+		/// Shared with the session's callback, which may outlive the coroutine that is waiting on the operation.
+		typedef struct
+		{
+			RconExecutor *executor;
+			/// The waiting coroutine, or null once it has been destroyed.
+			std::coroutine_handle<> handle;
+			std::optional<Result> result;
+		} state_t;
+
+		std::function<void(std::function<void(Result)>)> _start;
+		std::shared_ptr<state_t> _state;
+
+	public:
+		Operation(RconExecutor &executor, std::function<void(std::function<void(Result)>)> start) :
+			_start(std::move(start)),
+			_state(std::make_shared<state_t>(state_t{&executor, nullptr, std::nullopt})){};
+		Operation(Operation &&) = default;
+		Operation(const Operation &) = delete;
+		Operation &operator=(const Operation &) = delete;
+
+		/// A coroutine that is destroyed while it is suspended here destroys the awaiter too, which detaches it from the operation.
+		~Operation()
+		{
+			if (this->_state) this->_state->handle = nullptr;
+		}
+
+		bool await_ready() const noexcept { return false; }
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			this->_state->handle = handle;
+			// The callback may run before this returns, which is fine since the executor resumes the coroutine later.
+			this->_start([state = this->_state](Result result) {
+				state->result = std::move(result);
+				if (state->handle) state->executor->schedule(std::exchange(state->handle, nullptr));
+			});
+		}
+
+		Result await_resume() { return std::move(*this->_state->result); }
+	};
+
+	BasicAwaitableRcon(Session &session, RconExecutor &executor) : _session(session), _executor(executor){};
+
+	Session &session() { return this->_session; }
+
+	/**
+	 * @brief Connects the session through the executor's reactor.
+	 * @returns An awaitable that yields whether the connection was established.
+	 */
+	Operation<bool> connect();
+
+	/**
+	 * @returns An awaitable that yields whether the server accepted the password.
+	 */
+	Operation<bool> authenticate(const std::string &password);
+
+	/**
+	 * @returns An awaitable that yields the command's response, or an empty string if the command failed.
+	 */
+	Operation<std::string> command(const std::string &command);
+};
+
+/// An awaitable session with a server that speaks the original Source dialect.
+using AwaitableRcon = BasicAwaitableRcon<SourceDialect>;
+
+#define CPP_RCON_DECLARE_AWAITABLE(dialect) extern template class BasicAwaitableRcon<dialect>;
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DECLARE_AWAITABLE)
+#undef CPP_RCON_DECLARE_AWAITABLE
+
+#endif // _CPP_RCON_COROUTINE_
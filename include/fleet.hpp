@@ -0,0 +1,83 @@
+#pragma once
+#ifndef _CPP_RCON_FLEET_
+#define _CPP_RCON_FLEET_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "libindex.hpp"
+
+/**
+ * @brief A single server that a fleet command is run on.
+ */
+typedef struct
+{
+	rcon_addr_t address;
+	std::string password;
+	DIALECT dialect;
+} fleet_host_t;
+
+/**
+ * @brief The outcome of running a fleet command on a single server.
+ */
+typedef struct
+{
+	rcon_addr_t address;
+	bool success;
+	/// What went wrong, if the commands could not be run.
+	std::string error;
+	/// The response to each command, in order.
+	std::vector<std::string> responses;
+	/// How long connecting, authenticating and running the commands took. Steps that weren't reached are zero.
+	std::chrono::microseconds connect_time;
+	std::chrono::microseconds auth_time;
+	std::chrono::microseconds command_time;
+	std::chrono::microseconds total_time;
+} fleet_result_t;
+
+/**
+ * @brief Reads a list of servers from a file.
+ *
+ * Each line holds one server as `host[:port] [password [dialect]]`, where the host is a host name, an IPv4 address or an
+ * IPv6 address. IPv6 addresses need brackets to carry a port, as in `[::1]:27015`. The dialect is one of the names
+ * accepted by @ref parse_dialect, which lets a single list mix games. Blank lines and lines starting with `#` are ignored.
+ * @param default_port Used for servers without a port.
+ * @param default_password Used for servers without a password.
+ * @param default_dialect Used for servers without a dialect.
+ * @returns False if the file could not be read or contains an invalid line.
+ */
+bool read_fleet_hosts(const std::string &path, uint16_t default_port, const std::string &default_password, DIALECT default_dialect,
+					  std::vector<fleet_host_t> &hosts);
+
+/**
+ * @brief Connects to every server, authenticates and runs the same commands on each of them.
+ *
+ * Everything runs on a single @ref RconReactor, with every server's session speaking its own dialect. At most `parallel` servers are being talked to at any time, and the
+ * commands are pipelined to each server in a single write.
+ * @param on_result Called as soon as each server has finished, in the order they finish.
+ * @returns The number of servers the commands failed on.
+ */
+size_t run_fleet(const std::vector<fleet_host_t> &hosts, const std::vector<std::string> &commands, size_t parallel,
+				 const std::function<void(const fleet_result_t &)> &on_result);
+
+/**
+ * @brief Keeps a session open to every server and runs the same commands on all of them every `interval`, until the
+ * process is interrupted.
+ *
+ * Everything runs on a single thread, with the runs driven by an @ref RconScheduler. Lost connections are re-established
+ * in the background. Servers that can't be reached at all, or whose session couldn't be re-established, are tried again
+ * from scratch one interval later. Servers that reject the password are reported once and never tried again, since
+ * servers tend to ban addresses that keep failing to authenticate. A server that hasn't answered the previous run yet
+ * skips the next one.
+ * @param parallel The maximum number of servers to connect to at once.
+ * @param jitter Each run on each server is delayed by a random amount of up to this much.
+ * @param on_result Called after every run on every server. Only the response times are filled in, as `command_time`
+ * and `total_time`.
+ */
+void watch_fleet(const std::vector<fleet_host_t> &hosts, const std::vector<std::string> &commands, size_t parallel, std::chrono::milliseconds interval,
+				 std::chrono::milliseconds jitter, const std::function<void(const fleet_result_t &)> &on_result);
+
+#endif // _CPP_RCON_FLEET_
@@ -3,13 +3,18 @@
 #define _CPP_RCON_INDEX_
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
 #include <vector>
 #include <algorithm>
+#include <chrono>
 #include <memory>
-#include <regex>
 #include <boost/program_options.hpp>
 
 #include "libindex.hpp"
 #include "logger.hpp"
+#include "fleet.hpp"
+#include "script.hpp"
 
 #endif
\ No newline at end of file
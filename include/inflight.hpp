@@ -0,0 +1,111 @@
+#pragma once
+#ifndef _CPP_RCON_INFLIGHT_
+#define _CPP_RCON_INFLIGHT_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A flat table of in-flight requests keyed by a monotonically increasing integer key.
+ *
+ * Each key maps straight to the slot `key & (capacity - 1)`. Since keys are handed out sequentially and requests
+ * are completed roughly in order, the live keys always occupy a small window and never collide. If a new key does
+ * collide with a live one, the table doubles in size until it doesn't, so lookups are always a single slot probe.
+ * @tparam T The type stored for each request.
+ */
+template <typename T>
+class InflightTable
+{
+private:
+	struct slot_t
+	{
+		uint32_t key = 0;
+		bool used = false;
+		T value;
+	};
+
+	std::vector<slot_t> _slots;
+	size_t _size = 0;
+
+	size_t _index(uint32_t key) const { return key & (this->_slots.size() - 1); }
+
+	void _grow()
+	{
+		std::vector<slot_t> old_slots = std::move(this->_slots);
+		size_t capacity = old_slots.size() * 2;
+
+		bool collided;
+		do {
+			collided = false;
+			this->_slots = std::vector<slot_t>(capacity);
+			for (auto &slot : old_slots)
+			{
+				if (!slot.used) continue;
+				slot_t &target = this->_slots[this->_index(slot.key)];
+				if (target.used)
+				{
+					collided = true;
+					capacity *= 2;
+					break;
+				}
+				target.key = slot.key;
+				target.used = true;
+			}
+		} while (collided);
+
+		for (auto &slot : old_slots)
+		{
+			if (slot.used) this->_slots[this->_index(slot.key)].value = std::move(slot.value);
+		}
+	}
+
+public:
+	/**
+	 * @param initial_capacity The number of slots to start with. Must be a power of two.
+	 */
+	InflightTable(size_t initial_capacity = 64) : _slots(initial_capacity){};
+
+	/**
+	 * @brief Stores a value under a key that is not currently in the table.
+	 * @returns A pointer to the stored value. Stays valid until the table is modified again.
+	 */
+	T *insert(uint32_t key, T &&value)
+	{
+		while (this->_slots[this->_index(key)].used) this->_grow();
+
+		slot_t &slot = this->_slots[this->_index(key)];
+		slot.key = key;
+		slot.used = true;
+		slot.value = std::move(value);
+		this->_size++;
+		return &slot.value;
+	}
+
+	/**
+	 * @returns The value stored under `key`, or `nullptr` if there isn't one.
+	 */
+	T *find(uint32_t key)
+	{
+		slot_t &slot = this->_slots[this->_index(key)];
+		return (slot.used && slot.key == key) ? &slot.value : nullptr;
+	}
+
+	/**
+	 * @brief Removes the value stored under `key` and returns it.
+	 * The key must be in the table.
+	 */
+	T take(uint32_t key)
+	{
+		slot_t &slot = this->_slots[this->_index(key)];
+		slot.used = false;
+		this->_size--;
+		return std::move(slot.value);
+	}
+
+	size_t size() const { return this->_size; }
+
+	bool empty() const { return this->_size == 0; }
+};
+
+#endif // _CPP_RCON_INFLIGHT_
@@ -5,110 +5,657 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <cstring>
 #include <sstream>
 #include <iomanip>
 #include <cstdint>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <random>
 
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
-#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
 #include <fcntl.h>
 #include <errno.h>
 
 #include "logger.hpp"
-
-/**
- * @def MAX_PACKET_LENGTH
- * @brief The maximum length of a single RCON packet.
- * 
- * This specifies the max value that the packet size field can have.
- * The maximum length that a single RCON packet can be is 4096 bytes, excluding the packet size field.
- * The minimum length of an RCON packet is 10 bytes. Four for the packet id, four for the packet type,
- * and 2 null bytes (`0x00`) at the end, one to signify an empty body and another to signify the end of the packet.
-*/
-#define MAX_PACKET_LENGTH 4096
-/**
- * @def PACKET_PADDING_SIZE
- * @brief The size of all the fields surrounding the packet body that are included in calculating the total size of the packet.
- * 
- * (i.e. the packet id and type fields at the beginning, as well as the 2 terminator bytes at the end)
-*/
-#define PACKET_PADDING_SIZE sizeof(int32_t) * 2 + 2
+#include "packet.hpp"
+#include "inflight.hpp"
+#include "metrics.hpp"
+#include "resolver.hpp"
 
 typedef struct
 {
+	/// A host name, or an IPv4 or IPv6 address.
 	std::string ip;
 	uint16_t port;
 
-	std::string to_string();
+	std::string to_string() const;
 } rcon_addr_t;
 
-class Rcon {
+/**
+ * @brief How a session re-establishes a connection that was lost.
+ *
+ * The n-th attempt waits `initial_delay * multiplier^n`, capped at `max_delay`, and randomly shortened or lengthened by up
+ * to `jitter` of that, so that many clients that lost the same server don't all come back at the same moment.
+ */
+typedef struct
+{
+	/// Whether lost connections are re-established at all.
+	bool enabled;
+	std::chrono::milliseconds initial_delay;
+	std::chrono::milliseconds max_delay;
+	double multiplier;
+	/// A fraction between 0 and 1.
+	double jitter;
+	/// Gives up after this many failed attempts in a row. 0 retries forever.
+	int max_attempts;
+} reconnect_policy_t;
+
+/**
+ * @brief The dialect of Valve's Source engine, which defined the protocol. Also the default.
+ *
+ * A dialect describes how a game's server deviates from the protocol. @ref BasicRcon is templated on it, so everything
+ * a dialect changes is decided at compile time. A dialect is a type with these members:
+ */
+struct SourceDialect
+{
+	/// The longest command the server accepts in a single packet.
+	static constexpr size_t max_command_length = MAX_BODY_LENGTH;
+	/// The largest value of the packet size field the server sends. Anything larger means the stream is corrupt.
+	static constexpr size_t max_frame_length = MAX_FRAME_LENGTH;
+	/// Whether the server never splits a response over several packets. If so, a command completes with its first
+	/// response packet, and no sentinel packets are sent.
+	static constexpr bool single_packet_responses = false;
+	/// Whether the server echoes empty `SERVERDATA_RESPONSE_VALUE` packets, which lets the end of a multi-packet
+	/// response be detected without waiting for a timeout. See @ref BasicRcon::RESPONSE_END.
+	static constexpr bool echoes_empty_packets = true;
+	/// Whether the server sends an empty `SERVERDATA_RESPONSE_VALUE` right before every auth response.
+	static constexpr bool empty_packet_before_auth = true;
+};
+
+/**
+ * @brief Minecraft: Java Edition. Commands are limited to 1446 bytes, and auth responses come on their own.
+ */
+struct MinecraftDialect : SourceDialect
+{
+	static constexpr size_t max_command_length = 1446;
+	static constexpr bool empty_packet_before_auth = false;
+};
+
+/**
+ * @brief Factorio. Responses are never split, however long they are, so they arrive as a single oversized packet.
+ */
+struct FactorioDialect : SourceDialect
+{
+	static constexpr size_t max_frame_length = 16 * 1024 * 1024;
+	static constexpr bool single_packet_responses = true;
+	static constexpr bool empty_packet_before_auth = false;
+};
+
+/**
+ * @brief ARK: Survival Evolved. Every response is a single packet, and empty packets aren't answered.
+ */
+struct ArkDialect : SourceDialect
+{
+	static constexpr bool single_packet_responses = true;
+	static constexpr bool echoes_empty_packets = false;
+	static constexpr bool empty_packet_before_auth = false;
+};
+
+/**
+ * @def CPP_RCON_FOR_EACH_DIALECT
+ * @brief Expands `X(dialect)` for every built-in dialect. The library is compiled for exactly these.
+ */
+#define CPP_RCON_FOR_EACH_DIALECT(X) X(SourceDialect) X(MinecraftDialect) X(FactorioDialect) X(ArkDialect)
+
+/**
+ * @brief Names the built-in dialects at runtime, e.g. for picking one from the command line.
+ */
+enum class DIALECT
+{
+	SOURCE,
+	MINECRAFT,
+	FACTORIO,
+	ARK
+};
+
+/**
+ * @brief Parses a dialect name: `source`, `minecraft`, `factorio` or `ark`.
+ * @returns False if the name is unknown.
+ */
+bool parse_dialect(const std::string &name, DIALECT &dialect);
+
+/**
+ * @brief Calls `visitor` with a default constructed instance of the dialect type that `dialect` names.
+ * This is the one place a runtime choice of dialect turns into a type.
+ */
+template <typename Visitor>
+auto visit_dialect(DIALECT dialect, Visitor &&visitor)
+{
+	switch (dialect)
+	{
+		case DIALECT::MINECRAFT: return visitor(MinecraftDialect{});
+		case DIALECT::FACTORIO: return visitor(FactorioDialect{});
+		case DIALECT::ARK: return visitor(ArkDialect{});
+		default: return visitor(SourceDialect{});
+	}
+}
+
+class RconReactor;
+template <typename Dialect>
+class BasicConcurrentRcon;
+
+/**
+ * @brief A session with a single RCON server.
+ * @tparam Dialect The protocol dialect the server speaks, e.g. @ref SourceDialect. Use @ref Rcon for Source servers.
+ */
+template <typename Dialect>
+class BasicRcon {
+	friend class RconReactor;
+	friend class BasicConcurrentRcon<Dialect>;
+
+public:
+	enum class PACKET_TYPE {
+		SERVERDATA_AUTH = 3,
+		SERVERDATA_EXECCOMMAND = 2,
+		SERVERDATA_AUTH_RESPONSE = 2,
+		SERVERDATA_RESPONSE_VALUE = 0
+	};
+
+	/**
+	 * @brief How the end of a command's response is detected.
+	 */
+	enum class RESPONSE_END {
+		/// An empty `SERVERDATA_RESPONSE_VALUE` packet is sent after each command, and the response ends when the server echoes it.
+		/// Servers that never echo it are detected automatically and fall back to \ref TIMEOUT.
+		SENTINEL,
+		/// The response ends once no data has arrived for the response timeout.
+		TIMEOUT
+	};
+
+	/**
+	 * @brief Called once a command has completed.
+	 * @param success False if the command could not be sent, timed out, or the connection was lost.
+	 * @param response The concatenated bodies of every response packet.
+	 */
+	using CommandCallback = std::function<void(bool success, std::string response)>;
+	/**
+	 * @brief Called once every command in a batch has completed.
+	 * @param success False if any of the commands failed.
+	 * @param responses The response to each command, in the order the commands were given.
+	 */
+	using BatchCallback = std::function<void(bool success, std::vector<std::string> responses)>;
+	/**
+	 * @brief Called with each piece of a streamed response, in order, as soon as it has been read.
+	 * @param fragment The body of a single response packet. Only valid until the callback returns.
+	 */
+	using FragmentCallback = std::function<void(std::string_view fragment)>;
+	/**
+	 * @brief Called once a streamed command has completed, after its last fragment.
+	 * @param success False if the command could not be sent, timed out, or the connection was lost. Fragments that
+	 * were already delivered may then be all or only part of the response.
+	 */
+	using StreamCallback = std::function<void(bool success)>;
+	/**
+	 * @brief Called with a packet that the server sent on its own, rather than in response to a request.
+	 * @param packet The packet. Its body is only valid until the handler returns.
+	 */
+	using PacketHandler = std::function<void(const rcon_packet_t &packet)>;
+
 private:
+	typedef struct
+	{
+		std::string response;
+		CommandCallback callback;
+		/// Set for streamed commands, whose fragments are handed to it instead of being collected in `response`.
+		FragmentCallback on_fragment;
+		std::chrono::steady_clock::time_point sent_at;
+		/// Whether a sentinel packet was sent after the command.
+		bool expects_sentinel;
+		/// Whether this is an auth request rather than a command.
+		bool is_auth;
+		/// Whether at least one response packet has arrived.
+		bool received_data;
+		/// The number of response packets that have arrived.
+		uint32_t packets;
+	} pending_command_t;
+
+	typedef struct
+	{
+		uint64_t id;
+		/// Whether the subscription is for every unsolicited packet rather than just those with `packet_id`.
+		bool any_id;
+		int32_t packet_id;
+		PacketHandler handler;
+	} subscription_t;
+
 	std::unique_ptr<Logger> _logger;
 	rcon_addr_t _rcon_addr;
 	int _rcon_socket;
 	/// Whether or not the \ref _rcon_socket is connected to an RCON server
 	bool _connected;
+	/// Whether the session is still resolving its host or connecting to it.
+	bool _connecting = false;
+	std::chrono::steady_clock::time_point _connect_started;
+	/// Covers the lookup and every connection attempt.
+	std::chrono::milliseconds _connect_timeout{2000};
+	/// How long a connection attempt gets before the next address is tried alongside it.
+	std::chrono::milliseconds _attempt_delay{250};
+	/// The lookup of the host, while \ref _resolving is set.
+	std::shared_future<resolution_t> _resolution;
+	bool _resolving = false;
+	/// The addresses to attempt, in order.
+	std::vector<resolved_addr_t> _candidates;
+	size_t _next_candidate = 0;
+	/// When the next address is tried, if the attempts in flight haven't finished by then.
+	std::chrono::steady_clock::time_point _next_attempt_at;
+	/// Whether a connection attempt is in flight on \ref _rcon_socket itself.
+	bool _primary_attempt = false;
+	/// Attempts racing the one on \ref _rcon_socket. Event loops don't watch these, so they are polled.
+	std::vector<int> _attempts;
 	/// The number of consecutive failed packets
 	int _failed_packets = 0;
+	reconnect_policy_t _reconnect_policy{false, std::chrono::milliseconds(250), std::chrono::seconds(30), 2.0, 0.2, 0};
+	/// Set from the moment a connection is lost until it has been re-established or the session gives up.
+	bool _reconnecting = false;
+	/// When the next reconnect attempt starts.
+	std::chrono::steady_clock::time_point _reconnect_at;
+	/// The number of reconnect attempts since the connection was lost.
+	int _reconnect_attempts = 0;
+	std::minstd_rand _jitter_rng{std::random_device{}()};
+	/// The password of the last auth request, used to authenticate again after a reconnect.
+	std::string _password;
+	bool _has_password = false;
+	/// How long to wait for more data before assuming a response is complete.
+	std::chrono::milliseconds _response_timeout{100};
+	/// How long to wait for more data while a sentinel echo is still expected.
+	std::chrono::milliseconds _sentinel_timeout{2000};
+	/// Set to false once the server has been seen ignoring a sentinel packet.
+	bool _sentinel_supported = true;
+	/// How the end of a response is detected. See \ref set_response_end.
+	RESPONSE_END _response_end = Dialect::echoes_empty_packets ? RESPONSE_END::SENTINEL : RESPONSE_END::TIMEOUT;
+	/// Reassembles the packets read from \ref _rcon_socket.
+	PacketFramer _framer{MAX_PACKET_LENGTH * 4, Dialect::max_frame_length};
+	RconMetrics _metrics;
 
-	std::random_device _rd;
-	std::mt19937 _rng;
-	std::uniform_int_distribution<std::mt19937::result_type> _default_dist;
+	/**
+	 * @brief Every request that has been sent but not completed yet.
+	 *
+	 * Packet IDs are handed out in pairs: each command gets an even ID, and its sentinel the odd ID right after it.
+	 * Requests are keyed by `id / 2`.
+	 */
+	InflightTable<pending_command_t> _inflight;
+	/// The next even packet ID to hand out.
+	int32_t _next_id = 2;
+	/// The oldest ID that may still be in \ref _inflight.
+	int32_t _oldest_id = 2;
+	/// The ID of the last auth request. Failed auth responses carry an ID of -1, so they are matched against this.
+	int32_t _auth_id = 0;
+	/// The ID of the last sentinel whose echo completed a command. Source servers follow the echo with a trailer packet
+	/// under the same ID, which is dropped instead of being taken for an unsolicited packet.
+	int32_t _last_sentinel_id = 0;
+	/// When the last packet was received.
+	std::chrono::steady_clock::time_point _last_receive;
+	/// Data that has been queued for sending but not written to the socket yet.
+	std::string _out_buffer;
+	/// How much of \ref _out_buffer has already been written.
+	size_t _out_offset = 0;
+	/// Set while an event loop (see \ref RconReactor) is driving the socket. Nothing may block while this is set.
+	bool _external_io = false;
+	/// Called once when the session is closed. Lets an event loop stop watching the socket before it is closed.
+	std::function<void()> _close_hook;
+	/// Called whenever a request is submitted while nothing else was in flight, since that's when a new timeout starts.
+	std::function<void()> _deadline_hook;
+	/// Called whenever a connection attempt has replaced the socket behind \ref _rcon_socket, which keeps its number.
+	std::function<void()> _socket_hook;
+	/// Called whenever a connection has been established.
+	std::function<void()> _connect_hook;
+	/// Set by event loops that perform the socket I/O themselves, such as the io_uring backend of \ref RconReactor.
+	/// Called instead of writing to the socket whenever there is something in \ref _out_buffer. The event loop takes
+	/// the data and reports back through \ref _handle_sent, while incoming data arrives through \ref _handle_received.
+	std::function<void()> _write_hook;
+	/// Packets that don't belong to any in-flight request are collected here while \ref get_pending_data is running.
+	std::map<uint32_t, std::vector<std::string>> *_unclaimed = nullptr;
+	/// Handlers for packets that don't belong to any request. See \ref subscribe.
+	std::vector<subscription_t> _subscriptions;
+	uint64_t _next_subscription = 1;
 
-	bool _send_data(const std::string &data);
+	/**
+	 * @brief Starts resolving the host and connecting to it without blocking.
+	 *
+	 * \ref _rcon_socket is valid from here on, so that an event loop can start watching it, but until the first attempt
+	 * has been started it is just a placeholder.
+	 * @returns False if the connection failed straight away.
+	 */
+	bool _start_connect();
+	/**
+	 * @brief Moves a connection along: picks up the finished lookup, checks the racing attempts, starts the next attempt
+	 * when it is due, and gives up once every attempt failed or the connect timeout has passed.
+	 * @returns False if the connection failed.
+	 */
+	bool _advance_connect(std::chrono::steady_clock::time_point now);
+	/// Starts connecting to the next candidate address.
+	void _start_attempt(std::chrono::steady_clock::time_point now);
+	/// Moves a socket onto \ref _rcon_socket's number.
+	void _adopt_socket(int socket);
+	/// Makes `socket` the session's connection and cancels every other attempt.
+	void _connection_established(int socket);
+	/// Closes every racing attempt and forgets the lookup.
+	void _abandon_attempts();
+	/**
+	 * @brief Gives up on the current connection.
+	 * Closes the session, unless it is reconnecting, in which case the next reconnect attempt is scheduled.
+	 * @returns False.
+	 */
+	bool _connect_failed(const std::string &reason);
+	/**
+	 * @brief Checks the result of the attempt on \ref _rcon_socket once it has become writable.
+	 * @returns Whether the connection was established.
+	 */
+	bool _finish_connect();
+	/// Blocks until the connection makes progress or `timeout` has passed, for sessions that aren't attached to an event loop.
+	void _wait_for_connect(std::chrono::milliseconds timeout);
+	/// The time at which the connection attempt times out or the next address is due.
+	std::chrono::steady_clock::time_point _connect_deadline() const;
+	/**
+	 * @brief Handles a connection that broke.
+	 * Closes the session, unless it may reconnect, in which case the next attempt is scheduled instead.
+	 */
+	void _connection_lost();
+	/// Schedules the next reconnect attempt, or closes the session if the policy has run out of attempts.
+	void _schedule_reconnect();
+	/// Starts a reconnect attempt.
+	void _attempt_reconnect();
+	/// Authenticates again and sends everything that was queued while the connection was down.
+	void _finish_reconnect();
+	/// Drives a reconnect from @ref poll, for sessions that aren't attached to an event loop.
+	bool _poll_reconnect(std::chrono::milliseconds timeout);
+	/**
+	 * @brief Writes everything in \ref _out_buffer.
+	 * Unless an event loop is driving the socket, this blocks until everything has been written.
+	 * @returns False if the data couldn't be sent.
+	 */
+	bool _send_pending();
+	/**
+	 * @brief Writes as much of \ref _out_buffer as the socket will take without blocking.
+	 * @returns False if the write failed, in which case the session has been closed.
+	 */
+	bool _flush();
+	/**
+	 * @brief Reads whatever is available on the socket into \ref _framer.
+	 * @returns 1 if data was read, 0 if there was nothing to read, and -1 if the session was closed
+	 * because the server hung up or the read failed.
+	 */
+	int _receive_data();
+	/**
+	 * @brief Waits until the socket is ready for the given `poll` events.
+	 * @returns The result of `poll`.
+	 */
+	int _wait_for(short events, std::chrono::milliseconds timeout);
+	/**
+	 * @brief Handles readiness events reported by an event loop.
+	 * @param events A mask of `EPOLL*` flags.
+	 */
+	void _handle_io(uint32_t events);
+	/**
+	 * @brief Handles data that an event loop has read from the socket.
+	 * @param length The number of bytes read, 0 if the server hung up, or a negated `errno` if the read failed.
+	 */
+	void _handle_received(const char *data, ssize_t length);
+	/**
+	 * @brief Handles the completion of a write that an event loop made on behalf of \ref _write_hook.
+	 * @param result The number of bytes written, or a negated `errno` if the write failed.
+	 * @param done Whether everything that was taken has been written.
+	 */
+	void _handle_sent(ssize_t result, bool done);
+	/**
+	 * @brief Times out a pending connection attempt or stale requests.
+	 */
+	void _handle_timeout(std::chrono::steady_clock::time_point now);
+	/**
+	 * @brief Dispatches every complete packet in \ref _framer.
+	 * @returns The number of packets dispatched.
+	 */
+	int _process_packets();
+	void _handle_packet(const rcon_packet_t &packet);
+	/**
+	 * @brief Hands a packet that doesn't belong to any request to its subscribers.
+	 * @returns Whether any subscriber took it.
+	 */
+	bool _dispatch_unsolicited(const rcon_packet_t &packet);
+	/**
+	 * @brief Sends a request and registers it as in flight.
+	 * The callback is called straight away if the request couldn't be sent.
+	 */
+	void _submit(PACKET_TYPE type, std::string_view body, bool is_auth, CommandCallback callback, FragmentCallback on_fragment = nullptr);
+	/**
+	 * @brief Encodes a request into \ref _out_buffer and registers it as in flight without sending it.
+	 * @returns The packet ID of the request.
+	 */
+	int32_t _queue(PACKET_TYPE type, std::string_view body, bool is_auth, CommandCallback callback, FragmentCallback on_fragment = nullptr);
+	/**
+	 * @brief Same as \ref _queue, but under an ID that the caller picked instead of the next one.
+	 */
+	void _queue_as(int32_t packet_id, PACKET_TYPE type, std::string_view body, bool is_auth, CommandCallback callback, FragmentCallback on_fragment = nullptr);
+	/**
+	 * @brief Logs why a command can't be sent right now, if it can't.
+	 */
+	bool _can_send(const std::string &command);
+	/**
+	 * @brief Removes a request from \ref _inflight and runs its callback.
+	 */
+	void _complete(int32_t packet_id, bool success);
+	/**
+	 * @brief Completes every request that has gone without a response for too long.
+	 */
+	void _expire_requests(std::chrono::steady_clock::time_point now);
+	/// The time at which the connection attempt or the oldest in-flight request times out.
+	std::chrono::steady_clock::time_point _next_deadline();
+	static int32_t _following_id(int32_t packet_id) { return packet_id >= __INT32_MAX__ - 2 ? 2 : packet_id + 2; }
+	static int32_t _preceding_id(int32_t packet_id) { return packet_id <= 2 ? __INT32_MAX__ - 1 : packet_id - 2; }
 public:
 
-	enum class PACKET_TYPE {
-		SERVERDATA_AUTH = 3,
-		SERVERDATA_EXECCOMMAND = 2,
-		SERVERDATA_AUTH_RESPONSE = 2,
-		SERVERDATA_RESPONSE_VALUE = 0
-	};
-
-	Rcon(rcon_addr_t addr);
-	~Rcon() {close();};
+	BasicRcon(rcon_addr_t addr);
+	~BasicRcon() {close();};
 	
 	/**
 	 * @brief Establishes a connection to a remote RCON server.
+	 *
+	 * The host is resolved through @ref RconResolver::shared. If it has several addresses, they are tried Happy Eyeballs
+	 * style: each attempt gets a head start of the attempt delay before the next address is tried alongside it, and the
+	 * first one to connect wins.
 	*/
 	void connect();
 
+	/**
+	 * @brief Sets how long connecting may take.
+	 * @param timeout Covers resolving the host and every connection attempt. Defaults to 2 seconds.
+	 * @param attempt_delay How long each attempt runs on its own before the next address is tried. Defaults to 250 ms.
+	 */
+	void set_connect_timeout(std::chrono::milliseconds timeout, std::chrono::milliseconds attempt_delay = std::chrono::milliseconds(250))
+	{
+		this->_connect_timeout = timeout;
+		this->_attempt_delay = attempt_delay;
+	}
+
 	bool is_connected() const {return this->_connected;}
 
+	/// Whether the connection was lost and is being re-established. Commands sent meanwhile are queued.
+	bool is_reconnecting() const {return this->_reconnecting;}
+
+	/**
+	 * @brief Sets how lost connections are re-established. Reconnecting is disabled by default.
+	 *
+	 * Once a connected session loses its connection, every command that was already sent fails, since there is no telling
+	 * whether the server ran it. Commands sent from then on are queued, and once the connection is back the session
+	 * authenticates again with the last password it used and sends them.
+	 */
+	void set_reconnect_policy(const reconnect_policy_t &policy) {this->_reconnect_policy = policy;}
+
+	/// The address of the RCON server this session connects to.
+	const rcon_addr_t &address() const {return this->_rcon_addr;}
+
+	/**
+	 * @brief The session's counters and latency histograms.
+	 * Call @ref RconMetrics::snapshot on them to read them, which is safe from any thread.
+	 */
+	const RconMetrics &metrics() const {return this->_metrics;}
+
+	/**
+	 * @brief Sets the minimum level of the messages this session logs. Defaults to `DEBUG`.
+	 */
+	void set_log_level(LOG_LEVEL level) {this->_logger->log_level = level;}
+
+	/**
+	 * @brief Sets how the end of a command's response is detected. Defaults to @ref RESPONSE_END::SENTINEL, unless the
+	 * dialect doesn't echo empty packets. Has no effect for dialects whose responses are always a single packet.
+	 */
+	void set_response_end(RESPONSE_END mode)
+	{
+		this->_response_end = mode;
+		this->_sentinel_supported = true;
+	}
+
+	/**
+	 * @brief Sets how long the socket may stay idle before a response is considered complete.
+	 * @param timeout Used when no sentinel echo is expected. Defaults to 100 ms.
+	 * @param sentinel_timeout Used while waiting for a sentinel echo. Defaults to 2 seconds.
+	 */
+	void set_response_timeout(std::chrono::milliseconds timeout, std::chrono::milliseconds sentinel_timeout)
+	{
+		this->_response_timeout = timeout;
+		this->_sentinel_timeout = sentinel_timeout;
+	}
+
 	/**
 	 * @brief Authenticates with the RCON server
 	 * @returns Whether the authentication was successful
 	*/
 	bool authenticate(std::string &server_password);
 
+	/**
+	 * @brief Sends an auth request without waiting for the response.
+	 * @param callback Called by @ref poll once the server has answered. `success` says whether the password was accepted.
+	 */
+	void authenticate_async(const std::string &server_password, CommandCallback callback);
+
+	/**
+	 * @brief Sends a command and blocks until its response has arrived.
+	 * @returns The response, or an empty string if the command failed.
+	 */
 	std::string send_command(const std::string &command, PACKET_TYPE type = PACKET_TYPE::SERVERDATA_EXECCOMMAND);
 
+	/**
+	 * @brief Sends a command without waiting for its response.
+	 *
+	 * Any number of commands can be in flight at once. Responses are matched to commands by packet ID
+	 * and delivered by @ref poll, so the callback always runs on the thread that calls @ref poll.
+	 * @param callback Called once the command has completed.
+	 */
+	void send_command_async(const std::string &command, CommandCallback callback, PACKET_TYPE type = PACKET_TYPE::SERVERDATA_EXECCOMMAND);
+
+	/**
+	 * @brief Same as the callback version of @ref send_command_async, but returns a future instead.
+	 * The future only becomes ready once @ref poll has received the response.
+	 * An empty string is returned through the future if the command failed.
+	 */
+	std::future<std::string> send_command_async(const std::string &command, PACKET_TYPE type = PACKET_TYPE::SERVERDATA_EXECCOMMAND);
+
+	/**
+	 * @brief Sends a command and blocks until its response has arrived, handing the response over piece by piece.
+	 *
+	 * Nothing of the response is kept by the session, so even huge responses (`cvarlist`, ban lists, ...) only ever
+	 * take up as much memory as the packets that are being read at the time, and the first bytes arrive without
+	 * waiting for the rest.
+	 * @returns Whether the command completed.
+	 */
+	bool stream_command(const std::string &command, FragmentCallback on_fragment, PACKET_TYPE type = PACKET_TYPE::SERVERDATA_EXECCOMMAND);
+
+	/**
+	 * @brief Same as @ref stream_command, but doesn't wait for the response. Both callbacks are called by @ref poll.
+	 */
+	void stream_command_async(const std::string &command, FragmentCallback on_fragment, StreamCallback on_complete,
+							  PACKET_TYPE type = PACKET_TYPE::SERVERDATA_EXECCOMMAND);
+
+	/**
+	 * @brief Sends a list of commands at once and blocks until all of their responses have arrived.
+	 *
+	 * All of the commands are encoded into a single buffer and handed to the socket in one write.
+	 * @returns The response to each command, in order. Failed commands have an empty response.
+	 */
+	std::vector<std::string> send_batch(const std::vector<std::string_view> &commands);
+
+	/**
+	 * @brief Same as @ref send_batch, but doesn't wait for the responses.
+	 * @param callback Called by @ref poll once every command has completed.
+	 */
+	void send_batch_async(const std::vector<std::string_view> &commands, BatchCallback callback);
+
+	/**
+	 * @brief Reads any pending responses, completes their commands and times out stale ones.
+	 * While the session is reconnecting, this drives the reconnect instead.
+	 * @param timeout The longest time to wait for data to arrive.
+	 * @returns Whether the session is still connected or reconnecting.
+	 */
+	bool poll(std::chrono::milliseconds timeout);
+
+	/**
+	 * @brief Registers a handler for every packet the server pushes on its own, such as chat messages, kill feeds or
+	 * forwarded logs.
+	 *
+	 * Any packet whose ID doesn't belong to an in-flight request counts, which includes responses that only arrive
+	 * after their command has timed out. Handlers run as soon as the packet has been read: straight away on an
+	 * @ref RconReactor, or from @ref poll otherwise, so `while (session.poll(timeout)) {}` is enough to keep
+	 * listening on a session that has no event loop.
+	 * @returns An ID for @ref unsubscribe.
+	 */
+	uint64_t subscribe(PacketHandler handler);
+
+	/**
+	 * @brief Same as the other overload of @ref subscribe, but only for packets with the given ID. The session only
+	 * ever uses positive IDs for its own requests, so 0 and negative IDs are free for the server's use.
+	 */
+	uint64_t subscribe(int32_t packet_id, PacketHandler handler);
+
+	/**
+	 * @brief Removes a handler registered with @ref subscribe. Safe to call from inside a handler.
+	 */
+	void unsubscribe(uint64_t subscription);
+
+	/// The number of commands that have been sent but not completed yet.
+	size_t pending_commands() const { return this->_inflight.size(); }
+
 	/**
 	 * @brief Will retrieve any data packets waiting to be read by the socket.
-	 * @returns All of the retrieved data separated by the associated packet ID.
+	 * Packets belonging to in-flight commands are delivered to those commands instead, and packets that a subscriber
+	 * takes (see @ref subscribe) to that subscriber.
+	 * @returns The bodies of all of the retrieved packets separated by the associated packet ID.
 	*/
 	std::map<uint32_t, std::vector<std::string>> get_pending_data();
 
 	void get_socket_status();
 
 	/**
-	 * @brief Will close the active socket.
+	 * @brief Will close the active socket. Every in-flight command fails.
 	 */
-	void close() {
-		if (this->_connected)
-		{
-			::close(this->_rcon_socket);
-			puts("Connection closed.");
-		}
-		this->_connected = false;
-	};
+	void close();
 };
 
+/// A session with a server that speaks the original Source dialect, which most games do.
+using Rcon = BasicRcon<SourceDialect>;
+
+#define CPP_RCON_DECLARE_SESSION(dialect) extern template class BasicRcon<dialect>;
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DECLARE_SESSION)
+#undef CPP_RCON_DECLARE_SESSION
+
 #endif // _CPP_RCON_LIB_INDEX
\ No newline at end of file
@@ -2,6 +2,7 @@
 #ifndef _CPP_RCON_LOGGER_
 #define _CPP_RCON_LOGGER_
 
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <cstdint>
@@ -10,7 +11,23 @@
 #include <cmath>
 #include <iomanip>
 #include <memory>
+#include <sstream>
 #include <type_traits>
+#include <utility>
+
+/**
+ * @def CPP_RCON_MIN_LOG_LEVEL
+ * @brief The lowest log level that is compiled in at all, as the integer value of a @ref LOG_LEVEL.
+ *
+ * Messages below this level are rejected by @ref Logger::should_log at compile time, so the lazy logging
+ * overloads of @ref Logger drop them along with all of their formatting code.
+ * Release builds of the library set this to `1` (INFO) to strip all DEBUG output. Since @ref Logger::should_log is
+ * inline, code that links against the library has to be compiled with the same value. CMake targets that link
+ * `Lib-Cpp-RCON` inherit it; other build systems have to define it themselves.
+ */
+#ifndef CPP_RCON_MIN_LOG_LEVEL
+#define CPP_RCON_MIN_LOG_LEVEL 0
+#endif
 
 enum class LOG_LEVEL
 {
@@ -22,6 +39,36 @@ enum class LOG_LEVEL
 	FATAL
 };
 
+/**
+ * @brief How the timestamps in log headers are written.
+ */
+enum class TIMESTAMP_FORMAT
+{
+	/// Local date and time: `mm/dd/yyyy hh:mm:ss.mmm tz`
+	LOCAL,
+	/// Nanoseconds since the Unix epoch.
+	EPOCH_NANOSECONDS,
+	/// Nanoseconds on the monotonic clock. Unaffected by changes to the system time.
+	MONOTONIC_NANOSECONDS
+};
+
+/**
+ * @def TIMESTAMP_BUFFER_SIZE
+ * @brief The size of a buffer that can hold any timestamp written by @ref Logger::format_timestamp.
+ */
+#define TIMESTAMP_BUFFER_SIZE 64
+
+/**
+ * @brief What the asynchronous logging backend does when its queue is full.
+ */
+enum class LOG_OVERFLOW
+{
+	/// Discard the message. The number of discarded messages is reported once there is room again.
+	DROP,
+	/// Wait for the writer thread to make room.
+	BLOCK
+};
+
 /**
  * @brief Converts an integer type into a string in hexadecimal format. This function also prepends a "0x" to the output.
  * @tparam T Any integer type. Used to define how long the resulting output string will be.
@@ -60,7 +107,8 @@ class Logger
 {
 private:
 	std::string _label;
-	bool _should_print_header;
+	/// Atomic, since the same logger may be used from several threads at once.
+	std::atomic<bool> _should_print_header;
 
 public:
 	LOG_LEVEL log_level;
@@ -71,12 +119,74 @@ public:
 													 log_level(init_level),
 													 _should_print_header(true){};
 
+	/**
+	 * @brief Whether a message with the given level would be written.
+	 * Use this to skip expensive work that only exists to be logged.
+	 */
+	bool should_log(LOG_LEVEL level) const
+	{
+		return static_cast<int>(level) >= CPP_RCON_MIN_LOG_LEVEL && level >= this->log_level;
+	}
+
 	/**
 	 * @brief Gets the current date and time as a formatted string
 	 * @returns The current timestamp in the following format: `mm/dd/yyyy hh:mm:ss.mmm tz`
 	 */
 	std::string static get_timestamp();
 
+	/**
+	 * @brief Same as @ref get_timestamp, but formats the given time instead of the current time.
+	 */
+	std::string static get_timestamp(std::chrono::system_clock::time_point time);
+
+	/**
+	 * @brief Sets how every logger writes timestamps. Should be set before anything is logged.
+	 */
+	void static set_timestamp_format(TIMESTAMP_FORMAT format);
+
+	/**
+	 * @brief Reads the clock used by the current @ref TIMESTAMP_FORMAT.
+	 * @returns The current time in nanoseconds, to be passed to @ref format_timestamp.
+	 */
+	int64_t static capture_timestamp();
+
+	/**
+	 * @brief Writes a timestamp taken with @ref capture_timestamp in the current @ref TIMESTAMP_FORMAT.
+	 *
+	 * Local timestamps are cached per thread for a whole second, so only the milliseconds are written for
+	 * every message after the first one in that second.
+	 * @param buffer Must have room for at least @ref TIMESTAMP_BUFFER_SIZE characters. Not null terminated.
+	 * @returns The number of characters written.
+	 */
+	size_t static format_timestamp(char *buffer, int64_t timestamp);
+
+	/**
+	 * @brief Appends a complete log header for the given timestamp, label and level to `output`. See @ref print_header.
+	 */
+	void static format_header(std::string &output, int64_t timestamp, const std::string &label, LOG_LEVEL level);
+
+	/**
+	 * @brief Switches every logger over to asynchronous output.
+	 *
+	 * Instead of writing to stdout on the calling thread, messages are pushed into a lock-free queue of fixed-size records
+	 * and written out in batches by a background thread. Messages are still written in the order they were logged.
+	 * @param capacity The number of messages the queue can hold. Rounded up to a power of two.
+	 * @param overflow What to do with new messages while the queue is full.
+	 */
+	void static start_async(size_t capacity = 8192, LOG_OVERFLOW overflow = LOG_OVERFLOW::DROP);
+
+	/**
+	 * @brief Writes out everything still queued, stops the background thread and switches back to synchronous output.
+	 * Called automatically at exit. Other threads may keep logging: whatever they log afterwards is written synchronously,
+	 * and the backend is only torn down once every message that made it into the queue has been written.
+	 */
+	void static stop_async();
+
+	/**
+	 * @brief Blocks until every message logged so far has been written out. Does nothing in synchronous mode.
+	 */
+	void static flush();
+
 	/**
 	 * @brief Prints a log header to stdout. This header includes a trailing space.
 	 * 
@@ -102,6 +212,17 @@ public:
 	 */
 	void println(LOG_LEVEL level, const std::string &output);
 
+	/**
+	 * @brief Same as @ref println, but the message is only built if it is actually going to be written.
+	 * @param make_output A callable that returns the message to be logged. It isn't called if the level is filtered out.
+	 */
+	template <typename F, typename = std::enable_if_t<std::is_invocable_v<F>>>
+	void log(LOG_LEVEL level, F &&make_output)
+	{
+		if (!this->should_log(level)) return;
+		this->println(level, std::forward<F>(make_output)());
+	}
+
 	/**
 	 * @brief Runs the @ref println function with a logging level of `DEBUG`
 	 * @param output The message to be logged.
@@ -111,6 +232,16 @@ public:
 		this->println(LOG_LEVEL::DEBUG, output);
 	}
 
+	/**
+	 * @brief Runs the lazy @ref log function with a logging level of `DEBUG`
+	 * @param make_output A callable that returns the message to be logged.
+	 */
+	template <typename F, typename = std::enable_if_t<std::is_invocable_v<F>>>
+	void debug(F &&make_output)
+	{
+		this->log(LOG_LEVEL::DEBUG, std::forward<F>(make_output));
+	}
+
 	/**
 	 * @brief Runs the @ref println function with a logging level of `INFO`
 	 * @param output The message to be logged.
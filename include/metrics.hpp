@@ -0,0 +1,137 @@
+#pragma once
+#ifndef _CPP_RCON_METRICS_
+#define _CPP_RCON_METRICS_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A counter that is written by a single thread and may be read by any thread.
+ *
+ * Sessions are only ever driven by one thread, so a relaxed load and store is enough to count and avoids the cost of
+ * an atomic read-modify-write on every packet.
+ */
+class MetricCounter
+{
+private:
+	std::atomic<uint64_t> _value{0};
+
+public:
+	void add(uint64_t amount = 1) { this->_value.store(this->_value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed); }
+	uint64_t value() const { return this->_value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief A copy of a @ref MetricHistogram at one point in time.
+ */
+typedef struct
+{
+	/// The inclusive upper bound of each bucket.
+	std::vector<uint64_t> bounds;
+	/// The number of values in each bucket, not cumulative. The last entry counts the values above every bound.
+	std::vector<uint64_t> buckets;
+	uint64_t count;
+	uint64_t sum;
+
+	/**
+	 * @brief Estimates a percentile as the upper bound of the bucket it falls into.
+	 * @param fraction Between 0 and 1, e.g. 0.99 for the 99th percentile.
+	 * @returns 0 if nothing was recorded, and `UINT64_MAX` if the percentile is above the last bound.
+	 */
+	uint64_t percentile(double fraction) const;
+} histogram_snapshot_t;
+
+/**
+ * @brief A histogram with fixed buckets, written by a single thread and readable from any thread.
+ */
+class MetricHistogram
+{
+private:
+	std::vector<uint64_t> _bounds;
+	/// One more than there are bounds, for values above the last one.
+	std::unique_ptr<MetricCounter[]> _buckets;
+	MetricCounter _count;
+	MetricCounter _sum;
+
+public:
+	/**
+	 * @param bounds The inclusive upper bound of each bucket, in ascending order.
+	 */
+	MetricHistogram(std::vector<uint64_t> bounds);
+
+	void record(uint64_t value);
+	histogram_snapshot_t snapshot() const;
+};
+
+/**
+ * @brief A copy of a session's metrics at one point in time. See @ref RconMetrics.
+ */
+typedef struct
+{
+	/// Commands sent, not counting auth requests.
+	uint64_t commands_sent;
+	/// Commands and auth requests that failed for any reason, including timeouts.
+	uint64_t commands_failed;
+	/// Requests that got no response in time.
+	uint64_t timeouts;
+	uint64_t bytes_sent;
+	uint64_t bytes_received;
+	uint64_t packets_received;
+	/// Auth requests whose password was rejected.
+	uint64_t auth_failures;
+	uint64_t connection_losses;
+	uint64_t reconnect_attempts;
+	/// Reconnects that succeeded.
+	uint64_t reconnects;
+	/// From sending a command to the last packet of its response, in microseconds. Only successful commands are recorded.
+	histogram_snapshot_t command_rtt;
+	/// From sending an auth request to its response, in microseconds.
+	histogram_snapshot_t auth_latency;
+	/// The number of packets each successful command's response was made of.
+	histogram_snapshot_t packets_per_response;
+} session_metrics_t;
+
+/**
+ * @brief The metrics a session keeps about itself. Cheap enough to always be on.
+ *
+ * Only the session's own thread updates them, but @ref snapshot may be called from any thread.
+ */
+class RconMetrics
+{
+public:
+	MetricCounter commands_sent;
+	MetricCounter commands_failed;
+	MetricCounter timeouts;
+	MetricCounter bytes_sent;
+	MetricCounter bytes_received;
+	MetricCounter packets_received;
+	MetricCounter auth_failures;
+	MetricCounter connection_losses;
+	MetricCounter reconnect_attempts;
+	MetricCounter reconnects;
+	MetricHistogram command_rtt;
+	MetricHistogram auth_latency;
+	MetricHistogram packets_per_response;
+
+	RconMetrics();
+
+	RconMetrics(const RconMetrics &) = delete;
+	RconMetrics &operator=(const RconMetrics &) = delete;
+
+	session_metrics_t snapshot() const;
+};
+
+/**
+ * @brief Formats the metrics of any number of sessions in the Prometheus text exposition format.
+ *
+ * Every sample is labelled with `server="..."`, taken from the first element of each pair (e.g. the session's
+ * @ref rcon_addr_t::to_string). Latencies are exported in seconds, as Prometheus expects.
+ */
+std::string format_prometheus(const std::vector<std::pair<std::string, session_metrics_t>> &sessions);
+
+#endif // _CPP_RCON_METRICS_
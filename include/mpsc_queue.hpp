@@ -0,0 +1,74 @@
+#pragma once
+#ifndef _CPP_RCON_MPSC_QUEUE_
+#define _CPP_RCON_MPSC_QUEUE_
+
+#include <atomic>
+#include <utility>
+
+/**
+ * @brief An unbounded lock-free queue with any number of producers and a single consumer.
+ *
+ * A push is a single atomic exchange, so producers never wait on each other or on the consumer. A producer that is
+ * preempted halfway through a push briefly hides the values pushed after it: @ref pop reports the queue as empty
+ * until that push has finished, so whoever pushed last has to make sure the consumer looks again afterwards.
+ */
+template <typename T>
+class MpscQueue
+{
+private:
+	typedef struct node_t
+	{
+		std::atomic<node_t *> next;
+		T value;
+	} node_t;
+
+	/// The most recently pushed node. Producers swap themselves in here.
+	std::atomic<node_t *> _head;
+	/// The node before the oldest value. Only touched by the consumer.
+	node_t *_tail;
+
+public:
+	MpscQueue()
+	{
+		node_t *stub = new node_t{{nullptr}, T()};
+		this->_head.store(stub, std::memory_order_relaxed);
+		this->_tail = stub;
+	}
+
+	~MpscQueue()
+	{
+		T value;
+		while (this->pop(value)) {}
+		delete this->_tail;
+	}
+
+	MpscQueue(const MpscQueue &) = delete;
+	MpscQueue &operator=(const MpscQueue &) = delete;
+
+	/**
+	 * @brief Adds a value to the back of the queue. Safe to call from any thread.
+	 */
+	void push(T value)
+	{
+		node_t *node = new node_t{{nullptr}, std::move(value)};
+		node_t *previous = this->_head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Takes the value at the front of the queue. Must only be called from the consumer's thread.
+	 * @returns False if the queue is empty.
+	 */
+	bool pop(T &value)
+	{
+		node_t *next = this->_tail->next.load(std::memory_order_acquire);
+		if (!next) return false;
+		// The node that held the value becomes the new stub, so only the old one is freed.
+		value = std::move(next->value);
+		delete this->_tail;
+		this->_tail = next;
+		return true;
+	}
+};
+
+#endif // _CPP_RCON_MPSC_QUEUE_
@@ -0,0 +1,147 @@
+#pragma once
+#ifndef _CPP_RCON_PACKET_
+#define _CPP_RCON_PACKET_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @def MAX_PACKET_LENGTH
+ * @brief The maximum length of a single RCON packet.
+ *
+ * This specifies the max value that the packet size field can have.
+ * The maximum length that a single RCON packet can be is 4096 bytes, excluding the packet size field.
+ * The minimum length of an RCON packet is 10 bytes. Four for the packet id, four for the packet type,
+ * and 2 null bytes (`0x00`) at the end, one to signify an empty body and another to signify the end of the packet.
+*/
+#define MAX_PACKET_LENGTH 4096
+/**
+ * @def PACKET_PADDING_SIZE
+ * @brief The size of all the fields surrounding the packet body that are included in calculating the total size of the packet.
+ *
+ * (i.e. the packet id and type fields at the beginning, as well as the 2 terminator bytes at the end)
+*/
+#define PACKET_PADDING_SIZE sizeof(int32_t) * 2 + 2
+/**
+ * @def MAX_BODY_LENGTH
+ * @brief The longest body that fits into a single packet of at most @ref MAX_PACKET_LENGTH bytes.
+ *
+ * Responses longer than this have to be split over several packets.
+*/
+#define MAX_BODY_LENGTH (MAX_PACKET_LENGTH - (PACKET_PADDING_SIZE))
+/**
+ * @def MAX_FRAME_LENGTH
+ * @brief The largest value of the packet size field that the framer will accept before treating the stream as corrupt.
+ *
+ * Several servers (Minecraft for one) send bodies of up to 4096 bytes on top of the padding, so this is
+ * deliberately more lenient than @ref MAX_PACKET_LENGTH.
+*/
+#define MAX_FRAME_LENGTH (MAX_PACKET_LENGTH * 16)
+
+/**
+ * @brief A single decoded RCON packet.
+ *
+ * The body does not include the two terminating null bytes. It points into the receive buffer of the
+ * @ref PacketFramer that produced it and is only valid until the next call to @ref PacketFramer::prepare.
+ */
+typedef struct
+{
+	int32_t id;
+	int32_t type;
+	std::string_view body;
+} rcon_packet_t;
+
+/**
+ * @brief The number of bytes a packet with a body of the given length takes up on the wire, including the size field.
+ */
+inline size_t encoded_packet_size(size_t body_length)
+{
+	return sizeof(int32_t) + body_length + PACKET_PADDING_SIZE;
+}
+
+/**
+ * @brief Writes a complete packet into `destination`, which must have room for @ref encoded_packet_size bytes.
+ * @returns A pointer one past the last byte written.
+ */
+char *encode_packet(char *destination, int32_t id, int32_t type, std::string_view body);
+
+/**
+ * @brief Encodes a packet onto the end of `buffer`.
+ * The buffer is grown once and the packet is written straight into it, so a buffer that is reused
+ * keeps its capacity and encoding doesn't allocate at all.
+ */
+void append_packet(std::string &buffer, int32_t id, int32_t type, std::string_view body);
+
+/**
+ * @brief Splits a stream of bytes read from an RCON socket back into individual packets.
+ *
+ * Data is read straight into a reusable receive buffer (see @ref prepare and @ref commit), and
+ * @ref next hands out every complete packet currently buffered. A partial packet at the end of a read stays
+ * buffered until the rest of it arrives. Consumed space is reclaimed in place before the next read, so the
+ * buffer only ever grows when a single packet does not fit into it.
+ */
+class PacketFramer
+{
+private:
+	std::vector<char> _buffer;
+	/// Offset of the first byte that has not been handed out by @ref next yet.
+	size_t _read_pos = 0;
+	/// Offset one past the last byte received.
+	size_t _write_pos = 0;
+	/// Total size of the partially received packet at the read position, or 0 if there isn't one.
+	size_t _pending_size = 0;
+	/// Set once an impossible packet size has been read. The stream can't be resynchronized after that.
+	bool _corrupt = false;
+	size_t _max_frame_length;
+
+public:
+	/**
+	 * @param max_frame_length The largest packet size field that is accepted. Defaults to @ref MAX_FRAME_LENGTH.
+	 */
+	PacketFramer(size_t initial_capacity = MAX_PACKET_LENGTH * 4, size_t max_frame_length = MAX_FRAME_LENGTH) :
+		_buffer(initial_capacity), _max_frame_length(max_frame_length){};
+
+	/**
+	 * @brief Returns a pointer to free space in the receive buffer that the next read can be written into.
+	 * Invalidates the bodies of all packets returned by @ref next so far.
+	 * @param available Set to the number of bytes that can be written to the returned pointer.
+	 */
+	char *prepare(size_t &available);
+
+	/**
+	 * @brief Marks `count` bytes written into the space returned by @ref prepare as received.
+	 */
+	void commit(size_t count) { this->_write_pos += count; }
+
+	/**
+	 * @brief Decodes the next complete packet in the buffer.
+	 * @param packet Filled in with the decoded packet.
+	 * @returns Whether a complete packet was available.
+	 */
+	bool next(rcon_packet_t &packet);
+
+	/**
+	 * @brief Whether a packet with an invalid size field has been received.
+	 * Once this is set, the connection should be dropped since packet boundaries can no longer be found.
+	 */
+	bool is_corrupt() const { return this->_corrupt; }
+
+	/// The number of received bytes that have not been decoded yet.
+	size_t buffered() const { return this->_write_pos - this->_read_pos; }
+
+	/**
+	 * @brief Discards all buffered data. Should be called whenever the underlying connection is replaced.
+	 */
+	void reset()
+	{
+		this->_read_pos = 0;
+		this->_write_pos = 0;
+		this->_pending_size = 0;
+		this->_corrupt = false;
+	}
+};
+
+#endif // _CPP_RCON_PACKET_
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef _CPP_RCON_PROXY_
+#define _CPP_RCON_PROXY_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "libindex.hpp"
+#include "logger.hpp"
+#include "reactor.hpp"
+#include "server.hpp"
+
+/**
+ * @brief Shares a single authenticated connection to an RCON server between any number of local clients.
+ *
+ * Clients connect to the proxy as if it were the game server and authenticate with the proxy's own password.
+ * Their commands are pipelined onto one upstream session, which hands out its own packet IDs, and each response is
+ * sent back to the client that asked for it under the client's original packet ID. The game server only ever sees
+ * one connection and one handshake, no matter how many tools are attached.
+ *
+ * The upstream session is connected when the proxy starts listening and reconnected on demand if it drops.
+ * Commands that arrive while it is connecting are queued and forwarded once it is ready. A client whose command fails
+ * upstream is disconnected, since an empty response would look like the command ran and printed nothing.
+ */
+class RconProxy
+{
+private:
+	enum class UPSTREAM_STATE
+	{
+		DISCONNECTED,
+		CONNECTING,
+		READY
+	};
+
+	typedef struct
+	{
+		std::string command;
+		RconServer::Responder respond;
+	} queued_command_t;
+
+	RconReactor &_reactor;
+	std::unique_ptr<Logger> _logger;
+	RconServer _server;
+	Rcon _upstream;
+	std::string _upstream_password;
+	UPSTREAM_STATE _state = UPSTREAM_STATE::DISCONNECTED;
+	/// Commands received while the upstream session wasn't ready.
+	std::deque<queued_command_t> _waiting;
+
+	/// Starts connecting and authenticating the upstream session.
+	void _connect_upstream();
+	void _forward(std::string_view command, RconServer::Responder respond);
+
+public:
+	/**
+	 * @param reactor The event loop that drives both the clients and the upstream session. Must outlive the proxy.
+	 * @param upstream The RCON server to forward commands to.
+	 * @param upstream_password The password of the RCON server.
+	 * @param password The password clients have to authenticate to the proxy with.
+	 */
+	RconProxy(RconReactor &reactor, rcon_addr_t upstream, std::string upstream_password, std::string password);
+	~RconProxy() { this->close(); }
+
+	RconProxy(const RconProxy &) = delete;
+	RconProxy &operator=(const RconProxy &) = delete;
+
+	/**
+	 * @brief Starts accepting clients and connects to the upstream server.
+	 * @returns False if the listening socket could not be set up.
+	 */
+	bool listen(uint16_t port, const std::string &ip = "127.0.0.1");
+
+	/**
+	 * @brief Disconnects every client and the upstream session.
+	 */
+	void close();
+
+	/// Whether the upstream session is connected and authenticated.
+	bool upstream_ready() const { return this->_state == UPSTREAM_STATE::READY && this->_upstream.is_connected(); }
+
+	/// The number of connected clients.
+	size_t client_count() const { return this->_server.client_count(); }
+
+	/// The port the proxy is listening on.
+	uint16_t port() const { return this->_server.port(); }
+
+	/**
+	 * @brief Sets the minimum level of the messages the proxy, its server and its upstream session log.
+	 */
+	void set_log_level(LOG_LEVEL level)
+	{
+		this->_logger->log_level = level;
+		this->_server.set_log_level(level);
+		this->_upstream.set_log_level(level);
+	}
+};
+
+#endif // _CPP_RCON_PROXY_
@@ -0,0 +1,272 @@
+#pragma once
+#ifndef _CPP_RCON_REACTOR_
+#define _CPP_RCON_REACTOR_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include "libindex.hpp"
+#include "logger.hpp"
+#include "uring.hpp"
+
+/**
+ * @brief How an @ref RconReactor waits for events and does the I/O of its sessions.
+ */
+enum class REACTOR_BACKEND
+{
+	/// io_uring if it was compiled in and the kernel supports it, epoll otherwise.
+	AUTO,
+	/// Waits with `epoll_wait`, and sessions read and write their own sockets. Works everywhere.
+	EPOLL,
+	/// Sessions receive through multishot receives into a shared ring of provided buffers, and their writes are queued
+	/// up and submitted together with the wait for the next events. A round of the loop costs a single system call,
+	/// however many sessions it serves. Needs Linux 6.0 or newer.
+	IO_URING
+};
+
+/**
+ * @brief Parses a backend name: `auto`, `epoll` or `io_uring`.
+ * @returns False if the name is unknown.
+ */
+bool parse_reactor_backend(const std::string &name, REACTOR_BACKEND &backend);
+
+/**
+ * @brief A single threaded event loop that drives many RCON sessions (and any other file descriptors) from one epoll set.
+ *
+ * Sessions added with @ref add_session are connected, authenticated, written to and read from without ever blocking.
+ * Commands can be sent on them with @ref BasicRcon::send_command_async, and their callbacks run from inside @ref run_once.
+ * The blocking methods of a session (@ref BasicRcon::connect, @ref BasicRcon::send_command, @ref BasicRcon::poll, ...)
+ * must not be used while it is attached to a reactor. Sessions of every dialect can be mixed in one reactor.
+ *
+ * The reactor does not own its sessions. A session that is closed or destroyed is removed from the reactor automatically.
+ *
+ * Plain file descriptors are only ever polled for readiness, whichever @ref REACTOR_BACKEND is used, so their handlers
+ * work the same with either.
+ */
+class RconReactor
+{
+private:
+	/// Keeps the callback parameter of @ref add_session from taking part in deducing the dialect, so lambdas can be passed.
+	template <typename T>
+	struct _non_deduced
+	{
+		using type = T;
+	};
+
+public:
+	/**
+	 * @brief Called once a session added with @ref add_session is ready to use.
+	 * @param success False if the session could not connect or authenticate.
+	 */
+	template <typename Dialect>
+	using SessionCallback = typename _non_deduced<std::function<void(BasicRcon<Dialect> &session, bool success)>>::type;
+	/**
+	 * @brief Called when a watched file descriptor becomes ready.
+	 * @param events A mask of `EPOLL*` flags.
+	 */
+	using EventHandler = std::function<void(uint32_t events)>;
+
+private:
+	/// What a session's socket needs from the io_uring backend.
+	enum class SOCKET_STATE
+	{
+		/// Nothing, e.g. while waiting for the next reconnect attempt.
+		IDLE,
+		/// To be told once the connection attempt on it has finished.
+		CONNECTING,
+		/// Its data.
+		CONNECTED
+	};
+
+	/// The operations on a session whose dialect is only known to @ref add_session, which picks the table.
+	typedef struct
+	{
+		std::chrono::steady_clock::time_point (*next_deadline)(void *session);
+		void (*on_timeout)(void *session, std::chrono::steady_clock::time_point now);
+		/// Clears every hook the reactor installed on the session.
+		void (*detach)(void *session);
+		SOCKET_STATE (*socket_state)(void *session);
+		void (*on_received)(void *session, const char *data, ssize_t length);
+		void (*on_sent)(void *session, ssize_t result, bool done);
+	} session_ops_t;
+
+	typedef struct
+	{
+		/// Distinguishes this watch from earlier ones on the same file descriptor, so stale events can be discarded.
+		uint32_t generation;
+		EventHandler on_event;
+		/// The session behind this watch, or `nullptr` for plain file descriptors.
+		void *session;
+		const session_ops_t *ops;
+		/// The deadline that has been pushed onto \ref _deadlines for this watch, if any.
+		std::chrono::steady_clock::time_point timer_at;
+
+		/// The events watched for, which the io_uring backend resubmits whenever its poll has run out.
+		uint32_t events;
+		/// Bumped whenever the io_uring operations on the watch are replaced, so that completions of the old ones can be ignored.
+		uint8_t arm;
+		bool poll_armed;
+		bool receive_armed;
+		/// A write of a session that is in flight on the io_uring backend. Its data lives in `send_buffer` until it completes.
+		bool send_in_flight;
+		uint8_t send_arm;
+		std::string send_buffer;
+		size_t send_offset;
+	} watch_t;
+
+	/// What a completion on the io_uring backend belongs to. Stored in the user data next to the watch it is for.
+	enum class URING_OP : uint64_t
+	{
+		POLL,
+		RECEIVE,
+		SEND,
+		CANCEL
+	};
+
+	typedef struct
+	{
+		std::chrono::steady_clock::time_point at;
+		int fd;
+		uint32_t generation;
+	} deadline_t;
+
+	struct later_deadline
+	{
+		bool operator()(const deadline_t &a, const deadline_t &b) const { return a.at > b.at; }
+	};
+
+	std::unique_ptr<Logger> _logger;
+	REACTOR_BACKEND _backend;
+	int _epoll_fd = -1;
+	std::unique_ptr<IoUring> _uring;
+	/// Whether the kernel supports multishot receives. Without them, every receive is submitted again once it completes.
+	bool _multishot_receive = true;
+	/// The buffers of sends that were still in flight when their watch went away, kept until the kernel is done with them.
+	std::vector<std::pair<uint64_t, std::string>> _retired_sends;
+	/// Every watch, indexed by file descriptor.
+	std::vector<std::shared_ptr<watch_t>> _watches;
+	size_t _watch_count = 0;
+	uint32_t _next_generation = 1;
+	/// Session timeouts, soonest first. Entries that no longer match their watch's `timer_at` are skipped.
+	std::priority_queue<deadline_t, std::vector<deadline_t>, later_deadline> _deadlines;
+	std::vector<struct epoll_event> _events;
+	bool _stopped = false;
+
+	bool _add(int fd, uint32_t events, std::shared_ptr<watch_t> watch);
+	/// Registers a session's socket again after a reconnect has replaced it.
+	void _rearm(int fd, uint32_t generation);
+	/// Returns the watch for `fd` if it is still the one with the given generation.
+	std::shared_ptr<watch_t> _find(int fd, uint32_t generation) const;
+	/// Makes sure the next timeout of a session is on \ref _deadlines.
+	void _schedule(int fd, watch_t &watch);
+	void _run_timers(std::chrono::steady_clock::time_point now);
+
+	int _run_epoll(std::chrono::milliseconds timeout);
+	int _run_uring(std::chrono::milliseconds timeout);
+	/// Handles a completion of the io_uring backend.
+	void _complete(const uring_completion_t &completion);
+	/// Submits whatever io_uring operations a watch is missing for the state it is in.
+	void _sync(int fd, watch_t &watch);
+	/// Cancels every io_uring operation of a watch and forgets about them.
+	void _disarm(int fd, watch_t &watch);
+	/// Takes the data a session has queued and submits it as a single io_uring send, unless one is in flight already.
+	void _send(int fd, uint32_t generation, std::string &out_buffer, size_t &out_offset);
+	void _submit_send(int fd, watch_t &watch);
+	static uint64_t _user_data(int fd, const watch_t &watch, URING_OP op, uint8_t arm);
+
+	template <typename Dialect>
+	static const session_ops_t _session_ops;
+	template <typename Dialect>
+	static void _detach_session(void *session);
+
+public:
+	/**
+	 * @param max_events The maximum number of events handled per call to `epoll_wait`. Also sizes the io_uring queues.
+	 * @param backend Falls back to epoll, with a warning, if io_uring was asked for but can't be used.
+	 */
+	RconReactor(size_t max_events = 256, REACTOR_BACKEND backend = REACTOR_BACKEND::AUTO);
+	~RconReactor();
+
+	RconReactor(const RconReactor &) = delete;
+	RconReactor &operator=(const RconReactor &) = delete;
+
+	/**
+	 * @brief Starts driving a session. If it isn't connected yet, it will be connected first.
+	 * @param on_connected Called once the session is connected, or straight away if it already was.
+	 * @returns False if the session could not be added.
+	 */
+	template <typename Dialect>
+	bool add_session(BasicRcon<Dialect> &session, SessionCallback<Dialect> on_connected);
+
+	/**
+	 * @brief Same as the other overload of @ref add_session, but also authenticates the session with `password`
+	 * before `on_ready` is called.
+	 */
+	template <typename Dialect>
+	bool add_session(BasicRcon<Dialect> &session, const std::string &password, SessionCallback<Dialect> on_ready);
+
+	/**
+	 * @brief Stops driving a session without closing it.
+	 *
+	 * On the io_uring backend, data that the kernel had already received for the session but the reactor hadn't handled
+	 * yet is lost, so only remove sessions that have nothing in flight.
+	 */
+	template <typename Dialect>
+	void remove_session(BasicRcon<Dialect> &session);
+
+	/**
+	 * @brief Watches an arbitrary file descriptor.
+	 * @param events The `EPOLL*` events to watch for. `EPOLLET` may be included.
+	 * @returns False if the file descriptor is already watched or could not be added.
+	 */
+	bool watch(int fd, uint32_t events, EventHandler handler);
+
+	/**
+	 * @brief Changes the events watched for on a file descriptor added with @ref watch.
+	 */
+	bool modify(int fd, uint32_t events);
+
+	/**
+	 * @brief Stops watching a file descriptor. Safe to call from inside its own handler.
+	 */
+	void unwatch(int fd);
+
+	/**
+	 * @brief Waits for and handles one round of events and timeouts.
+	 * @param timeout The longest time to wait for an event.
+	 * @returns The number of events handled, or -1 if `epoll_wait` failed.
+	 */
+	int run_once(std::chrono::milliseconds timeout);
+
+	/**
+	 * @brief Runs the loop until @ref stop is called or nothing is watched anymore.
+	 */
+	void run();
+
+	/**
+	 * @brief Makes @ref run return after the current round of events.
+	 */
+	void stop() { this->_stopped = true; }
+
+	/// The number of sessions and file descriptors being watched.
+	size_t size() const { return this->_watch_count; }
+
+	/// The backend in use, which is never @ref REACTOR_BACKEND::AUTO.
+	REACTOR_BACKEND backend() const { return this->_backend; }
+};
+
+#define CPP_RCON_DECLARE_REACTOR_SESSION(dialect) \
+	extern template bool RconReactor::add_session<dialect>(BasicRcon<dialect> &, RconReactor::SessionCallback<dialect>); \
+	extern template bool RconReactor::add_session<dialect>(BasicRcon<dialect> &, const std::string &, RconReactor::SessionCallback<dialect>); \
+	extern template void RconReactor::remove_session<dialect>(BasicRcon<dialect> &);
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DECLARE_REACTOR_SESSION)
+#undef CPP_RCON_DECLARE_REACTOR_SESSION
+
+#endif // _CPP_RCON_REACTOR_
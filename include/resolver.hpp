@@ -0,0 +1,127 @@
+#pragma once
+#ifndef _CPP_RCON_RESOLVER_
+#define _CPP_RCON_RESOLVER_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+
+/**
+ * @brief A single address that a host name resolved to.
+ */
+typedef struct
+{
+	struct sockaddr_storage address;
+	socklen_t length;
+
+	std::string to_string() const;
+} resolved_addr_t;
+
+/**
+ * @brief The outcome of a lookup.
+ */
+typedef struct
+{
+	bool success;
+	/// What went wrong, if the lookup failed.
+	std::string error;
+	/// In the order connections should be attempted: IPv6 and IPv4 addresses alternate, starting with the family the
+	/// system prefers (RFC 8305).
+	std::vector<resolved_addr_t> addresses;
+} resolution_t;
+
+/**
+ * @brief Resolves host names on a small pool of background threads and caches the results.
+ *
+ * Sessions resolve their host through @ref shared every time they connect, so a lookup never blocks an event loop and
+ * repeated connections to the same host cost no lookup at all. Concurrent lookups of the same host share a single request.
+ * Numeric addresses are parsed straight away and never reach the pool.
+ *
+ * `getaddrinfo` doesn't report the TTL of the records it returns, so answers are kept for a fixed time instead.
+ */
+class RconResolver
+{
+private:
+	typedef struct
+	{
+		std::shared_future<resolution_t> result;
+		/// Stays at the maximum until the lookup has finished.
+		std::chrono::steady_clock::time_point expires;
+		/// Identifies the request behind the entry.
+		uint64_t serial;
+	} entry_t;
+
+	typedef struct
+	{
+		std::string key;
+		std::string host;
+		uint16_t port;
+		uint64_t serial;
+		std::promise<resolution_t> promise;
+	} request_t;
+
+	/// Everything the worker threads touch. They are detached, so it has to outlive the resolver.
+	struct shared_state_t
+	{
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::deque<request_t> queue;
+		std::unordered_map<std::string, entry_t> cache;
+		std::chrono::seconds ttl{30};
+		std::chrono::seconds negative_ttl{5};
+		size_t threads = 0;
+		size_t idle = 0;
+		uint64_t next_serial = 0;
+		bool stopped = false;
+	};
+
+	std::shared_ptr<shared_state_t> _state;
+	size_t _max_threads;
+
+	static void _work(std::shared_ptr<shared_state_t> state);
+	static resolution_t _lookup(const std::string &host, uint16_t port, int flags);
+
+public:
+	/**
+	 * @param max_threads The maximum number of lookups that run at the same time. Threads are only started as needed.
+	 */
+	RconResolver(size_t max_threads = 8);
+	~RconResolver();
+
+	RconResolver(const RconResolver &) = delete;
+	RconResolver &operator=(const RconResolver &) = delete;
+
+	/// The resolver that every session uses.
+	static RconResolver &shared();
+
+	/**
+	 * @brief Starts resolving a host, or returns the cached result.
+	 * @param host A host name, or an IPv4 or IPv6 address. IPv6 addresses may be wrapped in brackets.
+	 * @returns A future that becomes ready once the lookup has finished. It is ready straight away for numeric addresses
+	 * and cached hosts.
+	 */
+	std::shared_future<resolution_t> resolve(const std::string &host, uint16_t port);
+
+	/**
+	 * @brief Sets how long results are cached.
+	 * @param ttl For successful lookups. Defaults to 30 seconds.
+	 * @param negative_ttl For failed lookups. Defaults to 5 seconds.
+	 */
+	void set_ttl(std::chrono::seconds ttl, std::chrono::seconds negative_ttl);
+
+	/**
+	 * @brief Drops every cached result, so that the next connection to each host resolves it again.
+	 */
+	void clear();
+};
+
+#endif // _CPP_RCON_RESOLVER_
@@ -0,0 +1,138 @@
+#pragma once
+#ifndef _CPP_RCON_SCHEDULER_
+#define _CPP_RCON_SCHEDULER_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "libindex.hpp"
+#include "reactor.hpp"
+#include "timer_wheel.hpp"
+
+/**
+ * @brief The outcome of a single run of a scheduled job.
+ */
+typedef struct
+{
+	/// The ID returned by @ref RconScheduler::add_job.
+	uint64_t job;
+	/// False if any command in the batch the job was sent with failed. See @ref RconScheduler.
+	bool success;
+	/// The response to each of the job's commands, in order.
+	std::vector<std::string> responses;
+	/// From sending the commands to the last response.
+	std::chrono::microseconds latency;
+	/// The number of runs that were skipped since the previous result, because this one was still pending.
+	uint64_t skipped;
+} scheduled_result_t;
+
+/**
+ * @brief Runs commands on sessions at fixed intervals, all from the thread that runs an @ref RconReactor.
+ *
+ * Jobs are kept in a hierarchical timer wheel, so adding, firing and rescheduling a job takes constant time no matter
+ * how many there are, and the reactor is only woken up for ticks that have something to do. Every job that comes due on
+ * the same tick on the same session is sent as a single batch (see @ref BasicRcon::send_batch_async). Since a batch
+ * only reports whether all of its commands succeeded, a failure is reported to every job in it.
+ *
+ * A job whose previous run hasn't completed yet skips its turn instead of piling up more commands on a slow server.
+ *
+ * Sessions have to stay alive, and should be attached to the same reactor, for as long as they have jobs.
+ */
+class RconScheduler
+{
+public:
+	using JobCallback = std::function<void(const scheduled_result_t &result)>;
+
+private:
+	using BatchCallback = std::function<void(bool success, std::vector<std::string> responses)>;
+
+	typedef struct
+	{
+		uint64_t id;
+		/// A session of whichever dialect, driven through `send_batch`.
+		void *session;
+		void (*send_batch)(void *session, const std::vector<std::string_view> &commands, BatchCallback callback);
+		std::vector<std::string> commands;
+		std::chrono::steady_clock::duration interval;
+		std::chrono::steady_clock::duration jitter;
+		JobCallback callback;
+		/// When the job is due before jitter is added. Advances by exactly `interval` every run, so it never drifts.
+		std::chrono::steady_clock::time_point base;
+		bool pending;
+		uint64_t skipped;
+	} job_t;
+
+	std::unique_ptr<Logger> _logger;
+	RconReactor &_reactor;
+	std::chrono::steady_clock::duration _resolution;
+	/// The time of tick 0.
+	std::chrono::steady_clock::time_point _epoch;
+	/// With 10 ms ticks, the wheel spans 7.7 days.
+	TimerWheel<job_t> _wheel;
+	std::unordered_map<uint64_t, std::shared_ptr<job_t>> _jobs;
+	uint64_t _next_job = 1;
+	int _timer_fd = -1;
+	/// The tick the timer is set to go off at, or 0 if it isn't set.
+	uint64_t _armed_tick = 0;
+	std::minstd_rand _jitter_rng{std::random_device{}()};
+
+	/// The first tick at or after `time`.
+	uint64_t _tick_at(std::chrono::steady_clock::time_point time) const;
+	/// Picks the next due time of a job and files it in the wheel.
+	void _schedule(const std::shared_ptr<job_t> &job);
+	/// Processes every tick up to `now` and fires the jobs that came due.
+	void _advance(std::chrono::steady_clock::time_point now);
+	/// Sends the due jobs, one batch per session.
+	void _fire(std::vector<std::shared_ptr<job_t>> &due);
+	/// Sets the timer to the next tick that has something to do.
+	void _arm();
+	uint64_t _add_job(std::shared_ptr<job_t> job);
+
+	template <typename Dialect>
+	static void _send_batch(void *session, const std::vector<std::string_view> &commands, BatchCallback callback);
+
+public:
+	/**
+	 * @param resolution The length of a tick. Jobs fire on the first tick after they are due.
+	 */
+	RconScheduler(RconReactor &reactor, std::chrono::milliseconds resolution = std::chrono::milliseconds(10));
+	~RconScheduler();
+
+	RconScheduler(const RconScheduler &) = delete;
+	RconScheduler &operator=(const RconScheduler &) = delete;
+
+	/**
+	 * @brief Runs `commands` on `session` every `interval`, starting one interval from now.
+	 * @param jitter Each run is delayed by a random amount of up to this much, which spreads the load of many jobs
+	 * with the same interval. Doesn't affect when later runs are due.
+	 * @param callback Called with the responses of each run.
+	 * @returns The ID of the job, for @ref remove_job.
+	 */
+	template <typename Dialect>
+	uint64_t add_job(BasicRcon<Dialect> &session, std::vector<std::string> commands, std::chrono::milliseconds interval,
+					 std::chrono::milliseconds jitter, JobCallback callback);
+
+	/**
+	 * @brief Stops running a job. A run that is still pending completes without calling the job's callback.
+	 * @returns False if there is no such job.
+	 */
+	bool remove_job(uint64_t job);
+
+	/// The number of jobs.
+	size_t size() const { return this->_jobs.size(); }
+};
+
+#define CPP_RCON_DECLARE_SCHEDULER(dialect) \
+	extern template uint64_t RconScheduler::add_job<dialect>(BasicRcon<dialect> &, std::vector<std::string>, std::chrono::milliseconds, \
+															 std::chrono::milliseconds, RconScheduler::JobCallback);
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DECLARE_SCHEDULER)
+#undef CPP_RCON_DECLARE_SCHEDULER
+
+#endif // _CPP_RCON_SCHEDULER_
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef _CPP_RCON_SCRIPT_
+#define _CPP_RCON_SCRIPT_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+
+#include "libindex.hpp"
+
+/**
+ * @brief The outcome of a single command run by @ref run_script.
+ */
+typedef struct
+{
+	/// The position of the command in the script, starting at 0.
+	uint64_t index;
+	std::string command;
+	bool success;
+	std::string response;
+	/// From sending the command to its completion.
+	std::chrono::microseconds latency;
+} script_result_t;
+
+/**
+ * @brief How @ref format_script_result writes a result.
+ */
+enum class SCRIPT_FORMAT
+{
+	/// One JSON object per line: `{"index":0,"command":"...","success":true,"latency_ms":1.234,"response":"..."}`.
+	JSONL,
+	/// A header line `index success latency_us command_length response_length`, followed by the raw command, the raw
+	/// response and a newline. Lets responses contain anything, including invalid UTF-8.
+	LENGTH_PREFIXED
+};
+
+/**
+ * @brief Runs every command read from `input`, one per line, on a connected session.
+ *
+ * Commands are pipelined: up to `window` of them are in flight at once. Reading and sending are interleaved, so a slow
+ * producer on the other end of a pipe doesn't hold up the responses to commands that were already sent. Empty lines
+ * are skipped.
+ * @param input_fd The file descriptor behind `input`. Input is then read from it directly and split into lines as it
+ * arrives, so that a line that hasn't been finished yet doesn't hold up the responses to the commands before it.
+ * -1 to read `input` through the stream instead, if that never blocks, as with regular files.
+ * @param on_result Called for every command, in the order the commands were read.
+ * @returns The number of commands that failed.
+ */
+template <typename Dialect>
+size_t run_script(BasicRcon<Dialect> &session, std::istream &input, int input_fd, size_t window, const std::function<void(const script_result_t &)> &on_result);
+
+#define CPP_RCON_DECLARE_SCRIPT(dialect) \
+	extern template size_t run_script<dialect>(BasicRcon<dialect> &, std::istream &, int, size_t, const std::function<void(const script_result_t &)> &);
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DECLARE_SCRIPT)
+#undef CPP_RCON_DECLARE_SCRIPT
+
+/**
+ * @brief Appends a result to `out` in the given format.
+ */
+void format_script_result(std::string &out, const script_result_t &result, SCRIPT_FORMAT format);
+
+#endif // _CPP_RCON_SCRIPT_
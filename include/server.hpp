@@ -0,0 +1,202 @@
+#pragma once
+#ifndef _CPP_RCON_SERVER_
+#define _CPP_RCON_SERVER_
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "libindex.hpp"
+#include "logger.hpp"
+#include "packet.hpp"
+#include "reactor.hpp"
+
+/**
+ * @brief The server side of the RCON protocol, for exposing a console over RCON.
+ *
+ * Clients are accepted and served on an @ref RconReactor, so any number of them can be handled from a single thread.
+ * Clients have to authenticate with the server's password before their commands are passed to the handler set with
+ * @ref on_command, and are disconnected after a failed attempt. Responses longer than @ref MAX_BODY_LENGTH are split over several packets.
+ *
+ * Commands may be answered asynchronously. Responses are still sent in the order the commands were received, which keeps
+ * clients that detect the end of a response with an empty `SERVERDATA_RESPONSE_VALUE` packet working.
+ */
+class RconServer
+{
+public:
+	/**
+	 * @brief Sends the response to a single command. Cheap to copy.
+	 *
+	 * Exactly one response has to be sent for every command, since later responses to the same client are held back until it is,
+	 * unless the client is disconnected instead.
+	 * Responding after the client has disconnected does nothing. The server must outlive every responder.
+	 */
+	class Responder
+	{
+	private:
+		RconServer *_server;
+		uint64_t _client;
+		uint64_t _sequence;
+
+	public:
+		Responder(RconServer *server, uint64_t client, uint64_t sequence) : _server(server), _client(client), _sequence(sequence){};
+
+		void operator()(std::string_view response) const { this->_server->_respond(this->_client, this->_sequence, response); }
+
+		/**
+		 * @brief Disconnects the client instead of responding, for commands that couldn't be run at all.
+		 * RCON has no way to report an error, and the client can tell a dropped connection apart from an empty response.
+		 * Responses to the client's other commands that haven't been sent yet are lost.
+		 */
+		void disconnect() const { this->_server->_disconnect(this->_client); }
+
+		/// Identifies the client that sent the command. Unique for the life of the server.
+		uint64_t client() const { return this->_client; }
+	};
+
+	/**
+	 * @brief Called for every command sent by an authenticated client.
+	 * @param command The body of the command. Only valid until the handler returns.
+	 * @param respond Must be called once with the response, either straight away or later on the reactor's thread.
+	 */
+	using CommandHandler = std::function<void(std::string_view command, Responder respond)>;
+
+private:
+	typedef struct
+	{
+		/// The ID of the request being answered.
+		int32_t packet_id;
+		/// Whether the response has been given yet.
+		bool ready;
+		/// The encoded response, if it was given while responses before it were still outstanding.
+		std::string packets;
+	} response_slot_t;
+
+	typedef struct
+	{
+		int socket;
+		std::string address;
+		bool authenticated;
+		PacketFramer framer;
+		/// Encoded responses that haven't been written to the socket yet.
+		std::string out_buffer;
+		size_t out_offset;
+		/// Responses that can't be sent yet, oldest first. The front slot always has the sequence number `first_sequence`.
+		std::deque<response_slot_t> slots;
+		uint64_t first_sequence;
+		/// Set while the client is over its limits and isn't being read from. See @ref set_client_limits.
+		bool paused;
+	} client_t;
+
+	RconReactor &_reactor;
+	std::unique_ptr<Logger> _logger;
+	std::string _password;
+	CommandHandler _handler;
+	int _listen_socket = -1;
+	uint16_t _port = 0;
+	uint64_t _next_client = 1;
+	std::unordered_map<uint64_t, std::unique_ptr<client_t>> _clients;
+	/// The client whose requests are currently being handled. Its responses are written out once all of them have been handled.
+	uint64_t _reading = 0;
+	size_t _max_pending_commands = 1024;
+	size_t _max_pending_bytes = 4 * 1024 * 1024;
+
+	void _accept();
+	void _handle_client(uint64_t id, uint32_t events);
+	/**
+	 * @brief Reads and handles requests from a client until the socket is drained or the client goes over its limits.
+	 * @returns False if the client was disconnected.
+	 */
+	bool _receive(uint64_t id, client_t &client);
+	/// Whether a client has at least `1 / divisor` of its allowed unanswered commands or unsent bytes waiting.
+	bool _over_limit(const client_t &client, size_t divisor) const;
+	/**
+	 * @brief Writes out a client's responses, and resumes reading from it once it has caught up.
+	 * @returns False if the client was disconnected.
+	 */
+	bool _pump(uint64_t id, client_t &client);
+	/**
+	 * @brief Answers a single request from a client.
+	 * @returns False if the client was disconnected.
+	 */
+	bool _handle_packet(uint64_t id, client_t &client, const rcon_packet_t &packet);
+	/// Reserves the next response slot of a client and returns its sequence number.
+	uint64_t _reserve(client_t &client, int32_t packet_id);
+	/**
+	 * @brief Returns where the response for a slot should be encoded.
+	 * The oldest outstanding response can go straight into the output buffer, later ones have to wait in their slot.
+	 */
+	std::string &_slot_buffer(client_t &client, uint64_t sequence);
+	/// Marks a slot as answered and moves every response that can now be sent into the output buffer.
+	void _release(client_t &client, uint64_t sequence);
+	void _respond(uint64_t id, uint64_t sequence, std::string_view response);
+	/// Encodes a response into as many packets as needed.
+	static void _encode_response(std::string &output, int32_t packet_id, std::string_view response);
+	/**
+	 * @brief Writes as much of a client's output as the socket will take.
+	 * @returns False if the client was disconnected.
+	 */
+	bool _flush(uint64_t id, client_t &client);
+	void _disconnect(uint64_t id);
+
+public:
+	/**
+	 * @param reactor The event loop that accepts and serves clients. Must outlive the server.
+	 * @param password The password clients have to authenticate with.
+	 */
+	RconServer(RconReactor &reactor, std::string password);
+	~RconServer() { this->close(); }
+
+	RconServer(const RconServer &) = delete;
+	RconServer &operator=(const RconServer &) = delete;
+
+	/**
+	 * @brief Sets the function that answers commands. Commands are answered with an empty response until this is set.
+	 */
+	void on_command(CommandHandler handler) { this->_handler = std::move(handler); }
+
+	/**
+	 * @brief Limits how much each client can have waiting on the server, so that clients that keep sending commands
+	 * without reading the responses can't make it run out of memory.
+	 *
+	 * Once a client has `max_commands` unanswered commands or `max_bytes` of unsent responses, the server stops reading
+	 * from it until both have dropped below half of that. Its requests back up in the kernel in the meantime, which
+	 * eventually stops the client from sending more. Defaults to 1024 commands and 4 MiB.
+	 */
+	void set_client_limits(size_t max_commands, size_t max_bytes)
+	{
+		this->_max_pending_commands = std::max<size_t>(max_commands, 1);
+		this->_max_pending_bytes = std::max<size_t>(max_bytes, 1);
+	}
+
+	/**
+	 * @brief Starts accepting clients.
+	 * @param port The port to listen on. 0 picks a free one, see @ref port.
+	 * @param ip The IPv4 address to listen on.
+	 * @returns False if the listening socket could not be set up.
+	 */
+	bool listen(uint16_t port, const std::string &ip = "0.0.0.0");
+
+	/**
+	 * @brief Disconnects every client and stops listening.
+	 */
+	void close();
+
+	/// The port the server is listening on.
+	uint16_t port() const { return this->_port; }
+
+	/// The number of connected clients.
+	size_t client_count() const { return this->_clients.size(); }
+
+	/**
+	 * @brief Sets the minimum level of the messages the server logs. Defaults to `WARNING`.
+	 */
+	void set_log_level(LOG_LEVEL level) { this->_logger->log_level = level; }
+};
+
+#endif // _CPP_RCON_SERVER_
@@ -0,0 +1,146 @@
+#pragma once
+#ifndef _CPP_RCON_TIMER_WHEEL_
+#define _CPP_RCON_TIMER_WHEEL_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A hierarchical timer wheel that counts time in ticks and hands out items as their tick comes up.
+ *
+ * The first level has a slot for each of the next 256 ticks, and each level above it covers 64 times the span of the
+ * one below, so inserting an item and advancing by a tick take constant time no matter how many items there are. Items
+ * further out than the span of the wheel wait in its last level, and are filed again whenever they come up too early.
+ *
+ * The wheel only holds weak references, so an item is cancelled by letting go of it.
+ * @tparam T The type of the items.
+ */
+template <typename T>
+class TimerWheel
+{
+public:
+	static constexpr unsigned LEVELS = 4;
+	static constexpr unsigned LEVEL0_BITS = 8;
+	static constexpr unsigned LEVEL_BITS = 6;
+	/// The number of ticks the wheel spans.
+	static constexpr uint64_t SPAN = 1ULL << (LEVEL0_BITS + (LEVELS - 1) * LEVEL_BITS);
+
+private:
+	typedef struct
+	{
+		std::weak_ptr<T> item;
+		uint64_t due;
+	} entry_t;
+
+	/// The last tick that has been processed.
+	uint64_t _tick = 0;
+	std::array<std::vector<std::vector<entry_t>>, LEVELS> _wheel;
+
+	static unsigned _shift(unsigned level) { return LEVEL0_BITS + (level - 1) * LEVEL_BITS; }
+
+	/**
+	 * @brief Files an entry in the slot for its due tick.
+	 * @param earliest The earliest tick it may be filed under, for entries that are overdue.
+	 */
+	void _insert(entry_t entry, uint64_t earliest)
+	{
+		uint64_t due = std::max(entry.due, earliest);
+		uint64_t delta = due - this->_tick;
+
+		if (delta < (1ULL << LEVEL0_BITS))
+		{
+			this->_wheel[0][due & ((1 << LEVEL0_BITS) - 1)].push_back(std::move(entry));
+			return;
+		}
+
+		for (unsigned level = 1; level < LEVELS; level++)
+		{
+			unsigned shift = _shift(level);
+			if (delta < (1ULL << (shift + LEVEL_BITS)) || level == LEVELS - 1)
+			{
+				if (level == LEVELS - 1) due = std::min<uint64_t>(due, this->_tick + (1ULL << (shift + LEVEL_BITS)) - 1);
+				this->_wheel[level][(due >> shift) & ((1 << LEVEL_BITS) - 1)].push_back(std::move(entry));
+				return;
+			}
+		}
+	}
+
+	/// Moves the entries in a slot of a higher level down to where they belong now.
+	void _cascade(unsigned level, size_t slot)
+	{
+		std::vector<entry_t> entries;
+		std::swap(entries, this->_wheel[level][slot]);
+		for (auto &entry : entries)
+		{
+			// Entries that are due on the current tick go into its slot, which is processed right after cascading.
+			if (!entry.item.expired()) this->_insert(std::move(entry), this->_tick);
+		}
+	}
+
+public:
+	TimerWheel()
+	{
+		this->_wheel[0].resize(1 << LEVEL0_BITS);
+		for (unsigned level = 1; level < LEVELS; level++) this->_wheel[level].resize(1 << LEVEL_BITS);
+	}
+
+	/// The last tick that has been processed.
+	uint64_t now() const { return this->_tick; }
+
+	/**
+	 * @brief Files an item under the tick it is due on. Items that are already due come up on the next tick.
+	 */
+	void insert(const std::shared_ptr<T> &item, uint64_t due) { this->_insert(entry_t{item, due}, this->_tick + 1); }
+
+	/**
+	 * @brief Processes every tick up to and including `target`.
+	 * @param on_due Called with each item that is still alive as its tick comes up, while @ref now is that tick.
+	 */
+	template <typename Callback>
+	void advance(uint64_t target, Callback &&on_due)
+	{
+		while (this->_tick < target)
+		{
+			this->_tick++;
+
+			// Whenever a level wraps around, the next slot of the level above is moved down, starting from the top.
+			if ((this->_tick & ((1 << LEVEL0_BITS) - 1)) == 0)
+			{
+				unsigned wrapped = 1;
+				while (wrapped < LEVELS - 1 && ((this->_tick >> _shift(wrapped)) & ((1 << LEVEL_BITS) - 1)) == 0) wrapped++;
+				for (unsigned level = wrapped; level >= 1; level--)
+				{
+					this->_cascade(level, (this->_tick >> _shift(level)) & ((1 << LEVEL_BITS) - 1));
+				}
+			}
+
+			std::vector<entry_t> entries;
+			std::swap(entries, this->_wheel[0][this->_tick & ((1 << LEVEL0_BITS) - 1)]);
+			for (auto &entry : entries)
+			{
+				std::shared_ptr<T> item = entry.item.lock();
+				if (!item) continue;
+				if (entry.due > this->_tick) this->_insert(std::move(entry), this->_tick + 1);
+				else on_due(std::move(item));
+			}
+		}
+	}
+
+	/**
+	 * @brief The next tick that has anything to do: either something is filed under it, or the first level wraps around
+	 * and something may cascade down.
+	 */
+	uint64_t next_tick() const
+	{
+		for (uint64_t tick = this->_tick + 1;; tick++)
+		{
+			if ((tick & ((1 << LEVEL0_BITS) - 1)) == 0 || !this->_wheel[0][tick & ((1 << LEVEL0_BITS) - 1)].empty()) return tick;
+		}
+	}
+};
+
+#endif // _CPP_RCON_TIMER_WHEEL_
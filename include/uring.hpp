@@ -0,0 +1,131 @@
+#pragma once
+#ifndef _CPP_RCON_URING_
+#define _CPP_RCON_URING_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @brief A finished operation, as read from the completion queue of an @ref IoUring.
+ */
+typedef struct
+{
+	/// The value the operation was submitted with.
+	uint64_t user_data;
+	/// A byte count, a mask of poll events, or a negated `errno`.
+	int32_t result;
+	/// Whether a multishot operation is still armed and will complete again.
+	bool more;
+	/// Whether the operation read into one of the provided buffers. If so, it must be handed back with @ref IoUring::recycle.
+	bool has_buffer;
+	uint16_t buffer;
+} uring_completion_t;
+
+/**
+ * @brief A minimal io_uring instance, driven with raw system calls, together with one ring of provided receive buffers.
+ *
+ * Operations are only queued by the methods that prepare them. They reach the kernel with the next call to
+ * @ref submit or @ref submit_and_wait, so any number of them costs a single system call.
+ *
+ * Only available on Linux, and only if the library was built with `CPP_RCON_IO_URING`. Otherwise, and on kernels that
+ * are too old (multishot receives need 6.0), @ref is_ready returns false.
+ */
+class IoUring
+{
+private:
+	int _ring_fd = -1;
+	std::string _error;
+
+	void *_ring_memory = nullptr;
+	size_t _ring_size = 0;
+	struct io_uring_sqe *_sqes = nullptr;
+	size_t _sqes_size = 0;
+	struct io_uring_cqe *_cqes = nullptr;
+
+	unsigned *_sq_head = nullptr;
+	unsigned *_sq_tail = nullptr;
+	unsigned _sq_mask = 0;
+	unsigned _sq_entries = 0;
+	unsigned *_cq_head = nullptr;
+	unsigned *_cq_tail = nullptr;
+	unsigned _cq_mask = 0;
+	/// Prepared operations that haven't been submitted yet.
+	unsigned _unsubmitted = 0;
+
+	void *_buffer_ring = nullptr;
+	size_t _buffer_ring_size = 0;
+	char *_buffers = nullptr;
+	size_t _buffer_size = 0;
+	unsigned _buffer_count = 0;
+	uint16_t _buffer_tail = 0;
+	bool _buffers_registered = false;
+
+	/// Unregisters the buffers and unmaps everything. Safe to call on a ring that was only partly set up.
+	void _release();
+	/// Returns a zeroed submission queue entry, submitting what is queued first if the queue is full.
+	struct io_uring_sqe *_next_sqe();
+	int _enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, size_t arg_size);
+
+public:
+	/**
+	 * @param entries The size of the submission queue. The completion queue is four times as big.
+	 * @param buffer_count The number of provided receive buffers. Rounded up to a power of two.
+	 * @param buffer_size The size of each receive buffer.
+	 */
+	IoUring(unsigned entries, unsigned buffer_count, size_t buffer_size);
+	~IoUring();
+
+	IoUring(const IoUring &) = delete;
+	IoUring &operator=(const IoUring &) = delete;
+
+	/// Whether the ring was set up. If not, @ref error says why.
+	bool is_ready() const { return this->_ring_fd >= 0; }
+	const std::string &error() const { return this->_error; }
+
+	/**
+	 * @brief Queues a poll for `events` (`EPOLL*` flags) on `fd`.
+	 * @param multishot Whether it stays armed and completes on every wakeup, much like an edge triggered epoll.
+	 */
+	bool poll(uint64_t user_data, int fd, uint32_t events, bool multishot);
+	/**
+	 * @brief Queues a receive on `fd` into one of the provided buffers.
+	 * @param multishot Whether it stays armed and completes once for every chunk of data that arrives.
+	 */
+	bool receive(uint64_t user_data, int fd, bool multishot);
+	/**
+	 * @brief Queues a send on `fd`. `data` has to stay valid until the send completes.
+	 */
+	bool send(uint64_t user_data, int fd, const char *data, size_t length);
+	/**
+	 * @brief Queues the cancellation of the operation that was submitted with `target`.
+	 */
+	bool cancel(uint64_t user_data, uint64_t target);
+
+	/**
+	 * @brief Submits the queued operations without waiting for any of them.
+	 * @returns The number of operations submitted, or a negated `errno`.
+	 */
+	int submit();
+	/**
+	 * @brief Submits the queued operations and waits until at least one operation has completed or `timeout` has passed.
+	 * @returns 0 or more on success, or a negated `errno`.
+	 */
+	int submit_and_wait(std::chrono::milliseconds timeout);
+	/**
+	 * @brief Takes the next completion off the completion queue.
+	 * @returns False if there are none left.
+	 */
+	bool next(uring_completion_t &completion);
+
+	/// The contents of a provided buffer, as named by @ref uring_completion_t::buffer.
+	const char *buffer(uint16_t id) const { return this->_buffers + (size_t) id * this->_buffer_size; }
+	/// Hands a provided buffer back to the kernel once its contents have been used.
+	void recycle(uint16_t id);
+};
+
+#endif // _CPP_RCON_URING_
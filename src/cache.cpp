@@ -0,0 +1,99 @@
+#include "cache.hpp"
+
+template <typename Dialect>
+void BasicRconCache<Dialect>::disallow(const std::string &command)
+{
+	this->_allowed.erase(command);
+
+	// A command that is still in flight keeps its entry until it completes, so that its waiters are answered.
+	auto entry = this->_entries.find(command);
+	if (entry != this->_entries.end() && !entry->second.in_flight) this->_entries.erase(entry);
+}
+
+template <typename Dialect>
+void BasicRconCache<Dialect>::invalidate()
+{
+	for (auto entry = this->_entries.begin(); entry != this->_entries.end();)
+	{
+		if (entry->second.in_flight) ++entry;
+		else entry = this->_entries.erase(entry);
+	}
+}
+
+template <typename Dialect>
+void BasicRconCache<Dialect>::send_command_async(const std::string &command, CommandCallback callback)
+{
+	if (this->_allowed.find(command) == this->_allowed.end())
+	{
+		this->_stats.bypassed++;
+		this->_session.send_command_async(command, std::move(callback));
+		return;
+	}
+
+	entry_t &entry = this->_entries[command];
+	if (entry.in_flight)
+	{
+		this->_stats.coalesced++;
+		entry.waiters.push_back(std::move(callback));
+		return;
+	}
+	if (std::chrono::steady_clock::now() < entry.expires)
+	{
+		this->_stats.hits++;
+		if (callback) callback(true, entry.response);
+		return;
+	}
+
+	this->_stats.misses++;
+	entry.in_flight = true;
+	entry.waiters.push_back(std::move(callback));
+	this->_session.send_command_async(command, [this, command](bool success, std::string response) {
+		this->_complete(command, success, std::move(response));
+	});
+}
+
+template <typename Dialect>
+std::string BasicRconCache<Dialect>::send_command(const std::string &command)
+{
+	bool finished = false;
+	std::string final_data;
+	this->send_command_async(command, [&](bool, std::string response) {
+		finished = true;
+		final_data = std::move(response);
+	});
+	while (!finished && this->_session.poll(std::chrono::milliseconds(2000))) {}
+	return final_data;
+}
+
+template <typename Dialect>
+void BasicRconCache<Dialect>::_complete(const std::string &command, bool success, std::string response)
+{
+	auto found = this->_entries.find(command);
+	if (found == this->_entries.end()) return;
+	entry_t &entry = found->second;
+
+	std::vector<CommandCallback> waiters = std::move(entry.waiters);
+	entry.waiters.clear();
+	entry.in_flight = false;
+
+	auto allowed = this->_allowed.find(command);
+	if (success && allowed != this->_allowed.end())
+	{
+		entry.response = response;
+		entry.expires = std::chrono::steady_clock::now() + allowed->second;
+	}
+	else
+	{
+		this->_entries.erase(found);
+	}
+
+	// The callbacks may send more commands through the cache, so the entry mustn't be touched after this.
+	for (auto &waiter : waiters)
+	{
+		if (waiter) waiter(success, response);
+	}
+}
+
+#define CPP_RCON_DEFINE_CACHE(dialect) template class BasicRconCache<dialect>;
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DEFINE_CACHE)
+#undef CPP_RCON_DEFINE_CACHE
@@ -0,0 +1,184 @@
+#include "concurrent.hpp"
+
+#include <sys/eventfd.h>
+
+template <typename Dialect>
+BasicConcurrentRcon<Dialect>::BasicConcurrentRcon(rcon_addr_t addr, REACTOR_BACKEND backend):
+	_logger(new Logger("RCON CONCURRENT", LOG_LEVEL::WARNING)),
+	_session(std::move(addr)),
+	_reactor(16, backend)
+{
+	this->_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (this->_wakeup_fd < 0)
+	{
+		this->_logger->fatal("LIBC \"eventfd\" error (" + std::to_string(errno) + "): " + strerror(errno));
+	}
+}
+
+template <typename Dialect>
+BasicConcurrentRcon<Dialect>::~BasicConcurrentRcon()
+{
+	this->_stop();
+	if (this->_wakeup_fd >= 0) ::close(this->_wakeup_fd);
+}
+
+template <typename Dialect>
+bool BasicConcurrentRcon<Dialect>::start(const std::string &password)
+{
+	if (this->_io_thread.joinable())
+	{
+		this->_logger->error("The session has already been started.");
+		return false;
+	}
+	if (this->_wakeup_fd < 0) return false;
+
+	std::promise<bool> ready;
+	std::future<bool> result = ready.get_future();
+	this->_stopping.store(false, std::memory_order_relaxed);
+	this->_io_thread = std::thread(&BasicConcurrentRcon::_run, this, password, std::move(ready));
+
+	if (result.get())
+	{
+		this->_running.store(true, std::memory_order_release);
+		return true;
+	}
+	this->_stop();
+	return false;
+}
+
+template <typename Dialect>
+void BasicConcurrentRcon<Dialect>::send_command_async(const std::string &command, CommandCallback callback, PACKET_TYPE packet_type)
+{
+	// Registering comes before the check, so _stop either sees this thread and waits for it to push, or has already
+	// cleared _running and this thread doesn't push at all.
+	this->_submitters.fetch_add(1, std::memory_order_seq_cst);
+	if (!this->_running.load(std::memory_order_seq_cst))
+	{
+		this->_submitters.fetch_sub(1, std::memory_order_release);
+		this->_logger->error("The session isn't running. Call start() before sending commands.");
+		if (callback) callback(false, "");
+		return;
+	}
+	this->_submissions.push(submission_t{command, packet_type, std::move(callback)});
+	this->_wake();
+	this->_submitters.fetch_sub(1, std::memory_order_release);
+}
+
+template <typename Dialect>
+std::future<std::string> BasicConcurrentRcon<Dialect>::send_command_async(const std::string &command, PACKET_TYPE packet_type)
+{
+	auto promise = std::make_shared<std::promise<std::string>>();
+	std::future<std::string> result = promise->get_future();
+	this->send_command_async(command, [promise](bool, std::string response) {
+		promise->set_value(std::move(response));
+	}, packet_type);
+	return result;
+}
+
+template <typename Dialect>
+std::string BasicConcurrentRcon<Dialect>::send_command(const std::string &command, PACKET_TYPE packet_type)
+{
+	return this->send_command_async(command, packet_type).get();
+}
+
+template <typename Dialect>
+void BasicConcurrentRcon<Dialect>::_wake()
+{
+	// The exchange comes after the push, so the I/O thread either still has to clear the flag and will see the
+	// submission when it drains afterwards, or has already cleared it and gets woken up here.
+	if (this->_wakeup_pending.exchange(true, std::memory_order_acq_rel)) return;
+	uint64_t one = 1;
+	if (::write(this->_wakeup_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+	{
+		this->_logger->error("LIBC \"write\" error (" + std::to_string(errno) + "): " + strerror(errno));
+	}
+}
+
+template <typename Dialect>
+void BasicConcurrentRcon<Dialect>::_run(std::string password, std::promise<bool> ready)
+{
+	bool reported = false;
+	auto report = [&](bool success) {
+		if (reported) return;
+		reported = true;
+		ready.set_value(success);
+	};
+
+	this->_reactor.watch(this->_wakeup_fd, EPOLLIN, [this](uint32_t) {
+		uint64_t count;
+		while (::read(this->_wakeup_fd, &count, sizeof(count)) > 0) {}
+		if (this->_stopping.load(std::memory_order_acquire))
+		{
+			this->_reactor.stop();
+			return;
+		}
+		this->_drain();
+	});
+	this->_reactor.add_session(this->_session, password, [&](Session &, bool success) { report(success); });
+
+	this->_reactor.run();
+
+	this->_session.close();
+	this->_reactor.unwatch(this->_wakeup_fd);
+	report(false);
+}
+
+template <typename Dialect>
+void BasicConcurrentRcon<Dialect>::_drain()
+{
+	// Submissions from here on wake the thread up again, so nothing is left behind once the queue looks empty.
+	this->_wakeup_pending.exchange(false, std::memory_order_acq_rel);
+
+	Session &session = this->_session;
+	int32_t first_id = session._next_id;
+	bool queued = false;
+	submission_t submission;
+	while (this->_submissions.pop(submission))
+	{
+		if (!session._can_send(submission.command))
+		{
+			if (submission.callback) submission.callback(false, "");
+			continue;
+		}
+		session._queue(submission.type, submission.command, false, std::move(submission.callback));
+		queued = true;
+	}
+
+	// Everything that was waiting goes out in a single write, behind whatever is already in flight.
+	if (queued && !session._send_pending())
+	{
+		for (int32_t id = first_id; id != session._next_id; id = Session::_following_id(id)) session._complete(id, false);
+	}
+}
+
+template <typename Dialect>
+void BasicConcurrentRcon<Dialect>::_stop()
+{
+	this->_running.store(false, std::memory_order_seq_cst);
+	// Submissions that got past the check before it was cleared still push and wake the thread up, so they have to
+	// be done before the thread and the eventfd go away.
+	while (this->_submitters.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+
+	if (this->_io_thread.joinable())
+	{
+		this->_stopping.store(true, std::memory_order_release);
+		uint64_t one = 1;
+		// EAGAIN means the counter is already set, so the thread wakes up either way.
+		if (::write(this->_wakeup_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		{
+			this->_logger->error("LIBC \"write\" error (" + std::to_string(errno) + "): " + strerror(errno));
+		}
+		this->_io_thread.join();
+	}
+
+	// Whatever was submitted while the thread was shutting down never reached the session.
+	submission_t submission;
+	while (this->_submissions.pop(submission))
+	{
+		if (submission.callback) submission.callback(false, "");
+	}
+}
+
+#define CPP_RCON_DEFINE_CONCURRENT(dialect) template class BasicConcurrentRcon<dialect>;
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DEFINE_CONCURRENT)
+#undef CPP_RCON_DEFINE_CONCURRENT
@@ -0,0 +1,90 @@
+#include "coroutine.hpp"
+
+#include <algorithm>
+
+RconExecutor::~RconExecutor()
+{
+	// Nothing queued may be resumed once its task is gone.
+	this->_ready.clear();
+	this->_tasks.clear();
+}
+
+void RconExecutor::spawn(RconTask<void> task)
+{
+	if (task.done()) return;
+	std::coroutine_handle<> handle = task.handle();
+	this->_tasks.push_back(std::move(task));
+	this->schedule(handle);
+	this->_resume_ready();
+}
+
+void RconExecutor::run()
+{
+	while (this->run_once(std::chrono::milliseconds(1000)) > 0) {}
+}
+
+size_t RconExecutor::run_once(std::chrono::milliseconds timeout)
+{
+	if (this->_ready.empty() && !this->_tasks.empty()) this->_reactor.run_once(timeout);
+	this->_resume_ready();
+
+	// Finished tasks are only destroyed here, never while one of their own coroutines is still on the stack. Nothing
+	// awaits a spawned task, so an exception it finished with is passed on to the caller. Further failed tasks are kept
+	// until the next call, so that none of their exceptions are lost.
+	std::exception_ptr failure;
+	this->_tasks.erase(
+		std::remove_if(this->_tasks.begin(), this->_tasks.end(), [&failure](const RconTask<void> &task) {
+			if (!task.done()) return false;
+			std::exception_ptr exception = task.handle() ? task.handle().promise().exception : nullptr;
+			if (!exception) return true;
+			if (failure) return false;
+			failure = exception;
+			return true;
+		}),
+		this->_tasks.end()
+	);
+	if (failure) std::rethrow_exception(failure);
+	return this->_tasks.size();
+}
+
+void RconExecutor::_resume_ready()
+{
+	while (!this->_ready.empty())
+	{
+		std::coroutine_handle<> handle = this->_ready.front();
+		this->_ready.pop_front();
+		handle.resume();
+	}
+}
+
+template <typename Dialect>
+typename BasicAwaitableRcon<Dialect>::template Operation<bool> BasicAwaitableRcon<Dialect>::connect()
+{
+	Session *session = &this->_session;
+	RconReactor *reactor = &this->_executor.reactor();
+	return Operation<bool>(this->_executor, [session, reactor](std::function<void(bool)> done) {
+		reactor->add_session(*session, [done](Session &, bool success) { done(success); });
+	});
+}
+
+template <typename Dialect>
+typename BasicAwaitableRcon<Dialect>::template Operation<bool> BasicAwaitableRcon<Dialect>::authenticate(const std::string &password)
+{
+	Session *session = &this->_session;
+	return Operation<bool>(this->_executor, [session, password](std::function<void(bool)> done) {
+		session->authenticate_async(password, [done](bool success, std::string) { done(success); });
+	});
+}
+
+template <typename Dialect>
+typename BasicAwaitableRcon<Dialect>::template Operation<std::string> BasicAwaitableRcon<Dialect>::command(const std::string &command)
+{
+	Session *session = &this->_session;
+	return Operation<std::string>(this->_executor, [session, command](std::function<void(std::string)> done) {
+		session->send_command_async(command, [done](bool, std::string response) { done(std::move(response)); });
+	});
+}
+
+#define CPP_RCON_DEFINE_AWAITABLE(dialect) template class BasicAwaitableRcon<dialect>;
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DEFINE_AWAITABLE)
+#undef CPP_RCON_DEFINE_AWAITABLE
@@ -0,0 +1,291 @@
+#include "fleet.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string_view>
+#include <utility>
+
+#include "logger.hpp"
+#include "reactor.hpp"
+#include "resolver.hpp"
+#include "scheduler.hpp"
+
+bool read_fleet_hosts(const std::string &path, uint16_t default_port, const std::string &default_password, DIALECT default_dialect,
+					  std::vector<fleet_host_t> &hosts)
+{
+	Logger logger("  RCON CLI  ", LOG_LEVEL::WARNING);
+	std::ifstream file(path);
+	if (!file)
+	{
+		logger.error("Could not open host list \"" + path + "\".");
+		return false;
+	}
+
+	std::string line;
+	size_t line_number = 0;
+	while (std::getline(file, line))
+	{
+		line_number++;
+		std::istringstream fields(line);
+		std::string address;
+		if (!(fields >> address) || address[0] == '#') continue;
+
+		fleet_host_t host{{address, default_port}, default_password, default_dialect};
+		std::string password;
+		if (fields >> password) host.password = password;
+		std::string dialect;
+		if (fields >> dialect && !parse_dialect(dialect, host.dialect))
+		{
+			logger.error(path + ":" + std::to_string(line_number) + ": unknown dialect \"" + dialect + "\".");
+			return false;
+		}
+
+		// A port follows the last colon, unless that colon is part of an IPv6 address. Those need brackets to carry a port.
+		size_t colon = address.rfind(':');
+		bool bracketed = address[0] == '[';
+		if (colon != std::string::npos && (bracketed ? colon > address.find(']') : colon == address.find(':')))
+		{
+			host.address.ip = address.substr(0, colon);
+			unsigned long port = strtoul(address.c_str() + colon + 1, nullptr, 10);
+			if (port == 0 || port > UINT16_MAX)
+			{
+				logger.error(path + ":" + std::to_string(line_number) + ": invalid port in \"" + address + "\".");
+				return false;
+			}
+			host.address.port = (uint16_t) port;
+		}
+
+		if (bracketed)
+		{
+			size_t closing = host.address.ip.find(']');
+			if (closing != host.address.ip.length() - 1)
+			{
+				logger.error(path + ":" + std::to_string(line_number) + ": invalid address \"" + address + "\".");
+				return false;
+			}
+			host.address.ip = host.address.ip.substr(1, closing - 1);
+		}
+		hosts.push_back(std::move(host));
+	}
+	return true;
+}
+
+size_t run_fleet(const std::vector<fleet_host_t> &hosts, const std::vector<std::string> &commands, size_t parallel,
+				 const std::function<void(const fleet_result_t &)> &on_result)
+{
+	using fleet_clock = std::chrono::steady_clock;
+
+	typedef struct
+	{
+		/// A session of whichever dialect the server speaks, closed through `close`.
+		std::shared_ptr<void> session;
+		void (*close)(void *session);
+		fleet_result_t result;
+		fleet_clock::time_point started;
+		fleet_clock::time_point step_started;
+	} fleet_job_t;
+
+	parallel = std::max<size_t>(parallel, 1);
+	RconReactor reactor(std::min<size_t>(parallel, 1024));
+	std::vector<std::string_view> command_views(commands.begin(), commands.end());
+	// Sessions are closed from inside their own callbacks, so they are only destroyed once the reactor has returned.
+	std::vector<std::shared_ptr<void>> finished;
+	size_t next_host = 0;
+	size_t active = 0;
+	size_t failures = 0;
+
+	auto elapsed = [](fleet_clock::time_point since) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(fleet_clock::now() - since);
+	};
+
+	auto finish = [&](const std::shared_ptr<fleet_job_t> &job, bool success, const char *error) {
+		job->result.success = success;
+		job->result.error = error;
+		job->result.total_time = elapsed(job->started);
+		job->close(job->session.get());
+		finished.push_back(std::move(job->session));
+		active--;
+		if (!success) failures++;
+		on_result(job->result);
+	};
+
+	auto start = [&](const fleet_host_t &host, auto dialect) {
+		using Session = BasicRcon<decltype(dialect)>;
+
+		auto job = std::make_shared<fleet_job_t>();
+		job->result.address = host.address;
+		job->result.success = false;
+		job->result.connect_time = job->result.auth_time = job->result.command_time = job->result.total_time = std::chrono::microseconds(0);
+		auto session = std::make_shared<Session>(host.address);
+		job->session = session;
+		job->close = [](void *session) { ((Session *) session)->close(); };
+		// Failures are reported through the results, so the sessions themselves stay quiet.
+		session->set_log_level(LOG_LEVEL::FATAL);
+		job->started = job->step_started = fleet_clock::now();
+		active++;
+
+		const std::string &password = host.password;
+		reactor.add_session(*session, [&, job](Session &session, bool connected) {
+			job->result.connect_time = elapsed(job->step_started);
+			if (!connected)
+			{
+				finish(job, false, "could not connect");
+				return;
+			}
+
+			job->step_started = fleet_clock::now();
+			Session *rcon = &session;
+			session.authenticate_async(password, [&, job, rcon](bool authenticated, std::string) {
+				job->result.auth_time = elapsed(job->step_started);
+				if (!authenticated)
+				{
+					finish(job, false, "authentication failed");
+					return;
+				}
+
+				job->step_started = fleet_clock::now();
+				rcon->send_batch_async(command_views, [&, job](bool success, std::vector<std::string> responses) {
+					job->result.command_time = elapsed(job->step_started);
+					job->result.responses = std::move(responses);
+					finish(job, success, success ? "" : "command failed");
+				});
+			});
+		});
+	};
+
+	// Start every lookup up front, so that the lookups of later hosts overlap with the connections to earlier ones.
+	for (const fleet_host_t &host : hosts) RconResolver::shared().resolve(host.address.ip, host.address.port);
+
+	while (next_host < hosts.size() || active > 0)
+	{
+		while (next_host < hosts.size() && active < parallel)
+		{
+			const fleet_host_t &host = hosts[next_host++];
+			visit_dialect(host.dialect, [&](auto dialect) { start(host, dialect); });
+		}
+		if (active > 0) reactor.run_once(std::chrono::milliseconds(100));
+		finished.clear();
+	}
+	return failures;
+}
+
+void watch_fleet(const std::vector<fleet_host_t> &hosts, const std::vector<std::string> &commands, size_t parallel, std::chrono::milliseconds interval,
+				 std::chrono::milliseconds jitter, const std::function<void(const fleet_result_t &)> &on_result)
+{
+	using fleet_clock = std::chrono::steady_clock;
+
+	typedef struct
+	{
+		/// A session of whichever dialect the server speaks, closed through `close`. Null while waiting for a retry.
+		std::shared_ptr<void> session;
+		void (*close)(void *session);
+		bool connecting;
+		fleet_clock::time_point retry_at;
+		/// The scheduler job that runs the commands once the session is ready, or 0.
+		uint64_t job;
+	} watched_host_t;
+
+	parallel = std::max<size_t>(parallel, 1);
+	RconReactor reactor(std::min<size_t>(std::max<size_t>(hosts.size(), 1), 1024));
+	RconScheduler scheduler(reactor);
+	std::vector<watched_host_t> watched(hosts.size(), watched_host_t{nullptr, nullptr, false, fleet_clock::time_point(), 0});
+	// Sessions are closed from inside their own callbacks, so they are only destroyed once the reactor has returned.
+	std::vector<std::shared_ptr<void>> finished;
+	size_t connecting = 0;
+	fleet_clock::time_point next_retry = fleet_clock::time_point();
+
+	auto report = [&](size_t index, bool success, const char *error, std::vector<std::string> responses, std::chrono::microseconds time) {
+		fleet_result_t result;
+		result.address = hosts[index].address;
+		result.success = success;
+		result.error = error;
+		result.responses = std::move(responses);
+		result.connect_time = result.auth_time = std::chrono::microseconds(0);
+		result.command_time = result.total_time = time;
+		on_result(result);
+	};
+
+	auto give_up = [&](size_t index, const char *error, bool retry) {
+		watched_host_t &host = watched[index];
+		if (host.job) scheduler.remove_job(std::exchange(host.job, 0));
+		host.close(host.session.get());
+		finished.push_back(std::move(host.session));
+		if (host.connecting) connecting--;
+		host.connecting = false;
+		host.retry_at = retry ? fleet_clock::now() + interval : fleet_clock::time_point::max();
+		next_retry = std::min(next_retry, host.retry_at);
+		report(index, false, error, {}, std::chrono::microseconds(0));
+	};
+
+	auto start = [&](size_t index, auto dialect) {
+		using Session = BasicRcon<decltype(dialect)>;
+
+		watched_host_t &host = watched[index];
+		auto session = std::make_shared<Session>(hosts[index].address);
+		host.session = session;
+		host.close = [](void *session) { ((Session *) session)->close(); };
+		host.connecting = true;
+		connecting++;
+		// Failures are reported through the results, so the sessions themselves stay quiet.
+		session->set_log_level(LOG_LEVEL::FATAL);
+		session->set_reconnect_policy({true, std::chrono::milliseconds(250), std::max(interval, std::chrono::milliseconds(1000)), 2.0, 0.2, 0});
+
+		const std::string &password = hosts[index].password;
+		reactor.add_session(*session, [&, index](Session &session, bool connected) {
+			if (!connected)
+			{
+				give_up(index, "could not connect", true);
+				return;
+			}
+			Session *rcon = &session;
+			session.authenticate_async(password, [&, index, rcon](bool authenticated, std::string) {
+				if (!authenticated)
+				{
+					// A wrong password stays wrong, and servers tend to ban addresses that keep trying.
+					give_up(index, "authentication failed, not retrying", false);
+					return;
+				}
+				watched[index].connecting = false;
+				connecting--;
+				watched[index].job = scheduler.add_job(*rcon, commands, interval, jitter, [&, index, rcon](const scheduled_result_t &run) {
+					report(index, run.success, run.success ? "" : "command failed", run.responses, run.latency);
+					// Once a reconnect has failed, or the password was rejected after it, the session is closed for good and
+					// has to start over like a host that couldn't be reached.
+					if (!run.success && !rcon->is_connected() && !rcon->is_reconnecting()) give_up(index, "connection lost", true);
+				});
+			});
+		});
+	};
+
+	for (const fleet_host_t &host : hosts) RconResolver::shared().resolve(host.address.ip, host.address.port);
+
+	while (true)
+	{
+		auto now = fleet_clock::now();
+		// Hosts are only looked at while some are waiting for a connection, since that is all there is to do for them.
+		if (next_retry <= now)
+		{
+			next_retry = fleet_clock::time_point::max();
+			for (size_t i = 0; i < hosts.size(); i++)
+			{
+				if (watched[i].session) continue;
+				if (watched[i].retry_at > now || connecting >= parallel)
+				{
+					next_retry = std::min(next_retry, std::max(watched[i].retry_at, now + std::chrono::milliseconds(100)));
+					continue;
+				}
+				visit_dialect(hosts[i].dialect, [&](auto dialect) { start(i, dialect); });
+			}
+		}
+
+		auto timeout = std::chrono::milliseconds(1000);
+		if (next_retry != fleet_clock::time_point::max())
+		{
+			timeout = std::clamp(std::chrono::duration_cast<std::chrono::milliseconds>(next_retry - now), std::chrono::milliseconds(0), timeout);
+		}
+		reactor.run_once(timeout);
+		finished.clear();
+	}
+}
@@ -6,33 +6,156 @@ std::string help_text =
 	"Usage: open-rcom [OPTIONS]\n\n"
 	
 	"	Connects to a remote RCON server and opens an interactive console\n"
-	"	which takes input from stdin.\n\n";
+	"	which takes input from stdin.\n\n"
 
-bool is_IPv4(const std::string& str) {
-	std::regex ipv4_regex(R"((\d{1,3})\.(\d{1,3})\.(\d{1,3})\.(\d{1,3}))");
-	std::smatch match;
-	
-	if (!std::regex_match(str, match, ipv4_regex)) {
-		return false;
+	"	With --hosts, runs the given commands on every server in the host list\n"
+	"	at once instead, and prints each server's responses as soon as it is done.\n"
+	"	Adding --every keeps polling every server at that interval until interrupted.\n\n"
+
+	"	With --batch, runs the given commands (or the commands read from stdin)\n"
+	"	without any prompts, pipelining them over the session, and prints one\n"
+	"	machine-readable record per command.\n\n";
+
+std::string format_ms(std::chrono::microseconds time)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.1f", time.count() / 1000.0);
+	return buffer;
+}
+
+bool read_script(const std::string &path, std::vector<std::string> &commands)
+{
+	std::ifstream file(path);
+	if (!file) return false;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (!line.empty()) commands.push_back(line);
+	}
+	return true;
+}
+
+int fleet_main(const std::string &hosts_path, uint16_t default_port, const std::string &default_password, DIALECT default_dialect, std::vector<std::string> commands, size_t parallel,
+			   std::chrono::milliseconds every, std::chrono::milliseconds jitter)
+{
+	std::vector<fleet_host_t> hosts;
+	if (!read_fleet_hosts(hosts_path, default_port, default_password, default_dialect, hosts)) return 1;
+	if (commands.empty()) {
+		std::cerr << "Fleet mode needs at least one command (--command or --script)." << std::endl;
+		return 1;
 	}
 
-	for (int i = 1; i <= 4; ++i) {
-		int num = std::stoi(match[i]);
-		if (num < 0 || num > 255) {
-			return false;
+	auto print_result = [&](const fleet_result_t &result) {
+		std::cout << "==> " << result.address.to_string() << " [" << (result.success ? "ok" : result.error) << ", " << format_ms(result.total_time) << " ms]\n";
+		for (size_t i = 0; i < result.responses.size(); i++) {
+			if (commands.size() > 1) std::cout << "$ " << commands[i] << '\n';
+			std::cout << result.responses[i];
+			if (!result.responses[i].empty() && result.responses[i].back() != '\n') std::cout << '\n';
 		}
+		std::cout.flush();
+	};
+
+	if (every.count() > 0) {
+		watch_fleet(hosts, commands, parallel, every, jitter, print_result);
+		return 0;
 	}
-	
-	return true;
+
+	std::vector<fleet_result_t> results;
+	results.reserve(hosts.size());
+	auto started = std::chrono::steady_clock::now();
+
+	size_t failures = run_fleet(hosts, commands, parallel, [&](const fleet_result_t &result) {
+		print_result(result);
+		results.push_back(result);
+	});
+	auto wall_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+
+	// The timing summary goes to stderr so that the responses on stdout can be piped on their own.
+	std::cerr << '\n' << std::left << std::setw(24) << "host" << std::setw(24) << "status" << std::right
+			  << std::setw(12) << "connect ms" << std::setw(12) << "auth ms" << std::setw(12) << "command ms" << std::setw(12) << "total ms" << '\n';
+	std::vector<std::chrono::microseconds> totals;
+	for (const auto &result : results) {
+		std::cerr << std::left << std::setw(24) << result.address.to_string() << std::setw(24) << (result.success ? "ok" : result.error) << std::right
+				  << std::setw(12) << format_ms(result.connect_time) << std::setw(12) << format_ms(result.auth_time)
+				  << std::setw(12) << format_ms(result.command_time) << std::setw(12) << format_ms(result.total_time) << '\n';
+		totals.push_back(result.total_time);
+	}
+	std::sort(totals.begin(), totals.end());
+
+	std::cerr << '\n' << hosts.size() << " hosts: " << hosts.size() - failures << " succeeded, " << failures << " failed in " << format_ms(wall_time) << " ms";
+	if (!totals.empty()) {
+		std::cerr << " (per host: p50 " << format_ms(totals[totals.size() / 2]) << " ms, p99 " << format_ms(totals[std::min(totals.size() - 1, totals.size() * 99 / 100)])
+				  << " ms, max " << format_ms(totals.back()) << " ms)";
+	}
+	std::cerr << std::endl;
+	return failures == 0 ? 0 : 2;
+}
+
+template <typename Dialect>
+int script_main(const rcon_addr_t &address, const std::string &password, const std::vector<std::string> &commands, SCRIPT_FORMAT format, size_t window)
+{
+	std::istringstream listed;
+	std::istream *input = &std::cin;
+	int input_fd = STDIN_FILENO;
+	if (!commands.empty()) {
+		std::string joined;
+		for (const auto &command : commands) joined += command + '\n';
+		listed.str(joined);
+		input = &listed;
+		input_fd = -1;
+	}
+
+	BasicRcon<Dialect> session(address);
+	// Everything on stdout has to be a record, so problems are reported on stderr instead of being logged.
+	session.set_log_level(LOG_LEVEL::FATAL);
+	session.set_reconnect_policy({true, std::chrono::milliseconds(250), std::chrono::seconds(10), 2.0, 0.2, 10});
+	session.connect();
+	if (!session.is_connected()) {
+		std::cerr << "Could not connect to " << address.to_string() << "." << std::endl;
+		return 1;
+	}
+	std::string server_password = password;
+	if (!session.authenticate(server_password)) {
+		std::cerr << "Failed to authenticate with " << address.to_string() << "." << std::endl;
+		return 1;
+	}
+
+	std::string record;
+	size_t failures = run_script(session, *input, input_fd, window, [&](const script_result_t &result) {
+		record.clear();
+		format_script_result(record, result, format);
+		std::cout.write(record.data(), record.length());
+		std::cout.flush();
+	});
+	session.close();
+	return failures == 0 ? 0 : 2;
 }
 
-bool attempt_reconnect(Rcon *session)
+template <typename Dialect>
+int console_main(const rcon_addr_t &address, std::string &password)
 {
-	for (int tries = 0; tries < 3; tries++) {
-		session->connect();
-		if (session->is_connected()) return true;
+	BasicRcon<Dialect> *rcon_session = new BasicRcon<Dialect>(address);
+	// Ride out server restarts: commands typed while the connection is down are sent once it is back.
+	rcon_session->set_reconnect_policy({true, std::chrono::milliseconds(250), std::chrono::seconds(10), 2.0, 0.2, 10});
+	rcon_session->connect();
+	if (!rcon_session->is_connected()) return 0;
+
+	rcon_session->authenticate(password);
+	std::string line;
+
+	while (true) {
+		std::cout << "$ ";
+		std::getline(std::cin, line);
+		if (std::cin.eof()) break;
+
+		// Print the response as it arrives, so that long listings start showing up straight away.
+		rcon_session->stream_command(line, [](std::string_view fragment) { std::cout << fragment; });
+		std::cout << '\n';
+
+		if (!rcon_session->is_connected() && !rcon_session->is_reconnecting()) break;
 	}
-	return false;
+	rcon_session->close();
+	return 0;
 }
 
 int main(int argc, char *argv[])
@@ -40,13 +163,32 @@ int main(int argc, char *argv[])
 	auto logger = std::make_unique<Logger>("  RCON CLI  ", LOG_LEVEL::DEBUG);
 	rcon_addr_t server_address{"127.0.0.1", 27015};
 	std::string server_password = "";
+	std::string hosts_path;
+	std::vector<std::string> commands;
+	std::string script_path;
+	size_t parallel;
+	std::string format_name;
+	size_t window;
+	std::string dialect_name;
+	long every_ms;
+	long jitter_ms;
 
 	po::options_description ops_desc("Options");
 	ops_desc.add_options()
 		("help,h", "Displays this help screen and exits.")
-		("ip,i", po::value<std::string>(&server_address.ip)->default_value("127.0.0.1"), "The remote IP address of the RCON server.")
-		("port,p", po::value<uint16_t>(&server_address.port)->default_value(27015), "The port that the server is listening on. This must be an IPv4 address.")
-		("password,pass,P", po::value<std::string>(&server_password)->implicit_value(""), "The password used for authenticating with the server. Specifying this option and leaving it blank will bypass the \"no password prompt\".");
+		("ip,i", po::value<std::string>(&server_address.ip)->default_value("127.0.0.1"), "The host name or IP address of the RCON server.")
+		("port,p", po::value<uint16_t>(&server_address.port)->default_value(27015), "The port that the server is listening on.")
+		("password,pass,P", po::value<std::string>(&server_password)->implicit_value(""), "The password used for authenticating with the server. Specifying this option and leaving it blank will bypass the \"no password prompt\".")
+		("hosts,H", po::value<std::string>(&hosts_path), "Runs the commands on every server listed in this file, one \"host[:port] [password [dialect]]\" per line. --port, --password and --dialect are used as defaults.")
+		("command,c", po::value<std::vector<std::string>>(&commands)->composing(), "A command to run in fleet mode. May be given more than once.")
+		("script,s", po::value<std::string>(&script_path), "A file of commands to run in fleet or batch mode, one per line. In batch mode, \"-\" reads them from stdin.")
+		("parallel,j", po::value<size_t>(&parallel)->default_value(256), "The maximum number of servers to talk to at once in fleet mode.")
+		("every,e", po::value<long>(&every_ms)->default_value(0), "In fleet mode, keeps a session open to every server and runs the commands every this many milliseconds until interrupted.")
+		("jitter", po::value<long>(&jitter_ms)->default_value(0), "With --every, delays each run on each server by a random amount of up to this many milliseconds.")
+		("batch,b", "Runs the commands given with --command or --script, or else the commands read from stdin, without any prompts.")
+		("format,f", po::value<std::string>(&format_name)->default_value("jsonl"), "The output format of batch mode: \"jsonl\" for one JSON object per command, or \"length-prefixed\" for a header line \"index success latency_us command_length response_length\" followed by the raw command and response.")
+		("window,w", po::value<size_t>(&window)->default_value(64), "The maximum number of commands in flight at once in batch mode.")
+		("dialect,d", po::value<std::string>(&dialect_name)->default_value("source"), "The RCON dialect the server speaks: \"source\", \"minecraft\", \"factorio\" or \"ark\". In fleet mode, the default for hosts that don't name their own.");
 	
 	po::variables_map vm;
 	po::store(po::parse_command_line(argc, argv, ops_desc), vm);
@@ -57,14 +199,37 @@ int main(int argc, char *argv[])
 		return 0;
 	}
 
-	logger->debug("IP: " + server_address.to_string());
-	// logger->debug("Password: " + server_password);
-	
-	if (!is_IPv4(server_address.ip)) {
-		std::cout << help_text << ops_desc << std::endl;
+	DIALECT dialect;
+	if (!parse_dialect(dialect_name, dialect)) {
+		std::cerr << "Unknown dialect \"" << dialect_name << "\"." << std::endl;
 		return 1;
 	}
 
+	if (vm.count("hosts")) {
+		if (vm.count("script") && !read_script(script_path, commands)) {
+			std::cerr << "Could not read script \"" << script_path << "\"." << std::endl;
+			return 1;
+		}
+		return fleet_main(hosts_path, server_address.port, server_password, dialect, commands, parallel, std::chrono::milliseconds(every_ms),
+						  std::chrono::milliseconds(jitter_ms));
+	}
+
+	if (vm.count("batch")) {
+		if (vm.count("script") && script_path != "-" && !read_script(script_path, commands)) {
+			std::cerr << "Could not read script \"" << script_path << "\"." << std::endl;
+			return 1;
+		}
+		if (format_name != "jsonl" && format_name != "length-prefixed") {
+			std::cerr << "Unknown output format \"" << format_name << "\"." << std::endl;
+			return 1;
+		}
+		SCRIPT_FORMAT format = format_name == "jsonl" ? SCRIPT_FORMAT::JSONL : SCRIPT_FORMAT::LENGTH_PREFIXED;
+		return visit_dialect(dialect, [&](auto dialect) { return script_main<decltype(dialect)>(server_address, server_password, commands, format, window); });
+	}
+
+	logger->debug("IP: " + server_address.to_string());
+	// logger->debug("Password: " + server_password);
+	
 	if (!vm.count("password")) {
 		std::cout << "You have not entered a password. Are you sure you want to continue? (y/N): ";
 		char response = getchar();
@@ -73,21 +238,5 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	Rcon *rcon_session = new Rcon(server_address);
-	rcon_session->connect();
-	if (!rcon_session->is_connected()) return 0;
-
-	rcon_session->authenticate(server_password);
-	std::string line;
-
-	while (true) {
-		std::cout << "$ ";
-		std::getline(std::cin, line);
-		if (std::cin.eof()) break;
-
-		std::cout << rcon_session->send_command(line) << '\n';
-
-		if (!rcon_session->is_connected() && !attempt_reconnect(rcon_session)) break;
-	}
-	rcon_session->close();
+	return visit_dialect(dialect, [&](auto dialect) { return console_main<decltype(dialect)>(server_address, server_password); });
 }
\ No newline at end of file
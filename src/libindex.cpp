@@ -1,103 +1,438 @@
 #include <libindex.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <thread>
 #include <vector>
 
-std::string rcon_addr_t::to_string()
+std::string rcon_addr_t::to_string() const
 {
+	// IPv6 addresses need brackets to keep their colons apart from the port's.
+	if (this->ip.find(':') != std::string::npos && this->ip.front() != '[') return "[" + this->ip + "]:" + std::to_string(this->port);
 	return this->ip + ":" + std::to_string(this->port);
 }
 
-Rcon::Rcon(rcon_addr_t addr):
+bool parse_dialect(const std::string &name, DIALECT &dialect)
+{
+	static const std::pair<const char *, DIALECT> names[] = {
+		{"source", DIALECT::SOURCE},
+		{"minecraft", DIALECT::MINECRAFT},
+		{"factorio", DIALECT::FACTORIO},
+		{"ark", DIALECT::ARK},
+	};
+	for (const auto &entry : names)
+	{
+		if (name == entry.first)
+		{
+			dialect = entry.second;
+			return true;
+		}
+	}
+	return false;
+}
+
+template <typename Dialect>
+BasicRcon<Dialect>::BasicRcon(rcon_addr_t addr):
 	_rcon_addr(addr),
 	_connected(false),
 	_logger(new Logger("RCON SESSION", LOG_LEVEL::DEBUG))
 {
-	// initialize the random number generator for picking the random packet ID.
-	this->_rng = std::mt19937(this->_rd());
-	this->_default_dist = std::uniform_int_distribution<std::mt19937::result_type>(1, __INT32_MAX__);
+	// Requests are encoded straight into this buffer, which keeps its capacity for the whole life of the session.
+	this->_out_buffer.reserve(MAX_PACKET_LENGTH);
 };
 
-std::string int_to_le_string(uint32_t);
 
-void Rcon::connect()
+template <typename Dialect>
+void BasicRcon<Dialect>::connect()
+{
+	if (!this->_start_connect()) return;
+	while (this->_connecting) this->_wait_for_connect(this->_connect_timeout);
+}
+
+template <typename Dialect>
+bool BasicRcon<Dialect>::_start_connect()
 {
-	if (this->_connected)
+	if (this->_connected || this->_connecting)
 	{
 		this->_logger->error("Socket already connected to RCON server. Please disconnect before starting another connection.");
-		return;
+		return false;
 	}
 
-	this->_rcon_socket = socket(AF_INET, SOCK_STREAM, 0);
+	// A reconnecting session keeps its socket number until it is closed for good.
+	if (!this->_reconnecting)
+	{
+		this->_rcon_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (this->_rcon_socket < 0)
+		{
+			this->_logger->error("Failed to create socket.");
+			return false;
+		}
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	this->_connect_started = now;
+	this->_connecting = true;
+	this->_resolving = true;
+	this->_resolution = RconResolver::shared().resolve(this->_rcon_addr.ip, this->_rcon_addr.port);
+	return this->_advance_connect(now);
+}
 
-	if (this->_rcon_socket < 0)
+template <typename Dialect>
+bool BasicRcon<Dialect>::_advance_connect(std::chrono::steady_clock::time_point now)
+{
+	if (this->_resolving)
+	{
+		if (this->_resolution.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			if (now >= this->_connect_deadline()) return this->_connect_failed("Timed out whilst resolving " + this->_rcon_addr.ip + ".");
+			return true;
+		}
+
+		const resolution_t &resolution = this->_resolution.get();
+		if (!resolution.success) return this->_connect_failed("Failed to resolve " + this->_rcon_addr.ip + ": " + resolution.error);
+		this->_resolving = false;
+		this->_candidates = resolution.addresses;
+		this->_next_candidate = 0;
+		this->_next_attempt_at = now;
+	}
+
+	if (!this->_attempts.empty())
+	{
+		std::vector<struct pollfd> poll_fds;
+		for (int attempt : this->_attempts) poll_fds.push_back({attempt, POLLOUT, 0});
+		::poll(poll_fds.data(), poll_fds.size(), 0);
+
+		for (size_t i = poll_fds.size(); i-- > 0;)
+		{
+			if (!poll_fds[i].revents) continue;
+
+			int error = 0;
+			socklen_t len = sizeof(error);
+			getsockopt(poll_fds[i].fd, SOL_SOCKET, SO_ERROR, &error, &len);
+			if (error == 0)
+			{
+				this->_connection_established(poll_fds[i].fd);
+				return true;
+			}
+
+			this->_logger->debug([&] { return "Connection attempt failed. ERRNO = " + std::to_string(error) + ": " + strerror(error); });
+			::close(poll_fds[i].fd);
+			this->_attempts.erase(this->_attempts.begin() + i);
+			// A failed attempt doesn't hold up the next one.
+			this->_next_attempt_at = now;
+		}
+	}
+
+	// Start the next attempt once the ones in flight have had their head start, or straight away if there are none left.
+	while (this->_connecting && this->_next_candidate < this->_candidates.size() &&
+		   (now >= this->_next_attempt_at || (!this->_primary_attempt && this->_attempts.empty())))
+	{
+		this->_start_attempt(now);
+	}
+	if (!this->_connecting) return true;
+
+	if (!this->_primary_attempt && this->_attempts.empty()) return this->_connect_failed("Failed to connect to the RCON server.");
+	if (now >= this->_connect_started + this->_connect_timeout) return this->_connect_failed("Socket timed out whilst waiting for connection.");
+	return true;
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_start_attempt(std::chrono::steady_clock::time_point now)
+{
+	const resolved_addr_t &candidate = this->_candidates[this->_next_candidate++];
+	this->_next_attempt_at = now + this->_attempt_delay;
+
+	int attempt = socket(candidate.address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (attempt < 0)
 	{
 		this->_logger->error("Failed to create socket.");
+		this->_next_attempt_at = now;
 		return;
 	}
 
-	struct sockaddr_in socket_address;
-
-	socket_address.sin_family = AF_INET;
-	socket_address.sin_port = htons(this->_rcon_addr.port);
-	socket_address.sin_addr.s_addr = inet_addr(this->_rcon_addr.ip.c_str());
+	// Requests are small and latency sensitive, so don't let Nagle's algorithm hold them back.
+	int no_delay = 1;
+	setsockopt(attempt, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
 
-	int connect_status = ::connect(this->_rcon_socket, (struct sockaddr *) &socket_address, sizeof(socket_address));
-	this->_logger->debug("CONNECT STATUS: " + std::to_string(connect_status));
-	this->_logger->debug("ERRNO = " + std::to_string(errno) + ": " + strerror(errno));
+	int connect_status = ::connect(attempt, (const struct sockaddr *) &candidate.address, candidate.length);
+	int connect_error = errno;
+	this->_logger->debug([&] { return "Connecting to " + candidate.to_string() + ". CONNECT STATUS: " + std::to_string(connect_status); });
 
-	if (connect_status == -1 && errno != EINPROGRESS)
+	if (connect_status == -1 && connect_error != EINPROGRESS)
 	{
-		this->_logger->error("Failed to connect to the RCON server.");
-		::close(this->_rcon_socket);
+		this->_logger->debug([&] { return "ERRNO = " + std::to_string(connect_error) + ": " + strerror(connect_error); });
+		::close(attempt);
+		this->_next_attempt_at = now;
 		return;
 	}
 
-	fcntl(this->_rcon_socket, F_SETFL, O_NONBLOCK);
+	if (connect_status == 0)
+	{
+		this->_attempts.push_back(attempt);
+		this->_connection_established(attempt);
+	}
+	else if (this->_primary_attempt)
+	{
+		this->_attempts.push_back(attempt);
+	}
+	else
+	{
+		// Event loops only watch the session's own socket number, so that's where the first attempt in flight goes.
+		this->_adopt_socket(attempt);
+		this->_primary_attempt = true;
+	}
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_adopt_socket(int socket)
+{
+	// Move the socket onto the session's socket number, so that an event loop can keep tracking the session by it.
+	// This also cancels whatever attempt was in flight on it.
+	dup3(socket, this->_rcon_socket, O_CLOEXEC);
+	::close(socket);
+	if (this->_socket_hook) this->_socket_hook();
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_connection_established(int socket)
+{
+	if (socket != this->_rcon_socket)
+	{
+		this->_attempts.erase(std::find(this->_attempts.begin(), this->_attempts.end(), socket));
+		this->_adopt_socket(socket);
+	}
+	this->_abandon_attempts();
+
+	this->_connecting = false;
+	this->_connected = true;
+	this->_last_receive = std::chrono::steady_clock::now();
+	if (this->_reconnecting) this->_finish_reconnect();
+	if (this->_connect_hook) this->_connect_hook();
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_abandon_attempts()
+{
+	for (int attempt : this->_attempts) ::close(attempt);
+	this->_attempts.clear();
+	this->_primary_attempt = false;
+	this->_resolving = false;
+	this->_resolution = std::shared_future<resolution_t>();
+	this->_candidates.clear();
+	this->_next_candidate = 0;
+}
+
+template <typename Dialect>
+bool BasicRcon<Dialect>::_connect_failed(const std::string &reason)
+{
+	this->_logger->error(reason);
+	this->_abandon_attempts();
+	if (this->_reconnecting)
+	{
+		this->_connecting = false;
+		shutdown(this->_rcon_socket, SHUT_RDWR);
+		this->_schedule_reconnect();
+	}
+	else
+	{
+		this->close();
+	}
+	return false;
+}
+
+template <typename Dialect>
+bool BasicRcon<Dialect>::_finish_connect()
+{
+	int error = 0;
+	socklen_t len = sizeof(error);
+	getsockopt(this->_rcon_socket, SOL_SOCKET, SO_ERROR, &error, &len);
+
+	if (error == 0)
+	{
+		this->_connection_established(this->_rcon_socket);
+		return this->_connected;
+	}
+
+	this->_logger->debug([&] { return "Connection attempt failed. ERRNO = " + std::to_string(error) + ": " + strerror(error); });
+	auto now = std::chrono::steady_clock::now();
+	this->_primary_attempt = false;
+	this->_next_attempt_at = now;
+	this->_advance_connect(now);
+	return this->_connected;
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_wait_for_connect(std::chrono::milliseconds timeout)
+{
+	auto now = std::chrono::steady_clock::now();
+	auto until = std::min<std::chrono::steady_clock::time_point>(now + timeout, this->_connect_deadline());
 
-	struct timeval select_timeout;
-	select_timeout.tv_sec = 2;
-	select_timeout.tv_usec = 0;
+	if (this->_resolving)
+	{
+		this->_resolution.wait_until(until);
+	}
+	else
+	{
+		std::vector<struct pollfd> poll_fds;
+		if (this->_primary_attempt) poll_fds.push_back({this->_rcon_socket, POLLOUT, 0});
+		for (int attempt : this->_attempts) poll_fds.push_back({attempt, POLLOUT, 0});
 
-	// Define our set of file descriptors, zero it out, and add our socket to the set.
+		auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(until - now) + std::chrono::milliseconds(1);
+		int ready = ::poll(poll_fds.data(), poll_fds.size(), std::max<int64_t>(wait.count(), 0));
+		this->_logger->debug([&] { return "RCON socket poll status (write): " + std::to_string(ready); });
+		if (ready > 0 && this->_primary_attempt && poll_fds[0].revents && this->_finish_connect()) return;
+	}
+	if (this->_connecting) this->_advance_connect(std::chrono::steady_clock::now());
+}
 
-	fd_set write_set;
-	FD_ZERO(&write_set);
-	FD_SET(this->_rcon_socket, &write_set);
+template <typename Dialect>
+std::chrono::steady_clock::time_point BasicRcon<Dialect>::_connect_deadline() const
+{
+	auto deadline = this->_connect_started + this->_connect_timeout;
+	if (!this->_resolving && this->_next_candidate < this->_candidates.size()) deadline = std::min(deadline, this->_next_attempt_at);
+	return deadline;
+}
 
-	int ready = select(this->_rcon_socket + 1, NULL, &write_set, NULL, &select_timeout);
-	this->_logger->debug("RCON socket select status (write): " + std::to_string(ready));
-	if (ready == 0) {
-		this->_logger->error("Socket timed out whilst waiting for connection.");
+template <typename Dialect>
+void BasicRcon<Dialect>::_connection_lost()
+{
+	// Only a session that was up can come back. Failing to connect in the first place is final.
+	if (!this->_reconnect_policy.enabled || (!this->_connected && !this->_reconnecting))
+	{
+		this->close();
 		return;
 	}
-	this->_connected = (ready == 1);
+
+	this->_logger->warn("Lost the connection to " + this->_rcon_addr.to_string() + ". Reconnecting...");
+	this->_metrics.connection_losses.add();
+	// Keep the socket number reserved. The next attempt replaces the socket behind it.
+	shutdown(this->_rcon_socket, SHUT_RDWR);
+	this->_connected = false;
+	this->_connecting = false;
+	this->_reconnecting = true;
+	this->_reconnect_attempts = 0;
+	this->_failed_packets = 0;
+	this->_framer.reset();
+	this->_out_buffer.clear();
+	this->_out_offset = 0;
+
+	// Whatever was already sent may or may not have run on the server, so it can't be replayed safely.
+	// The callbacks may queue new commands, which get IDs from last_sent on.
+	int32_t first_sent = this->_oldest_id;
+	int32_t last_sent = this->_next_id;
+	this->_oldest_id = last_sent;
+	for (int32_t id = first_sent; id != last_sent; id = _following_id(id))
+	{
+		if (this->_inflight.find(id >> 1)) this->_complete(id, false);
+	}
+
+	if (this->_reconnecting) this->_schedule_reconnect();
 }
 
-bool Rcon::authenticate(std::string &server_password)
+template <typename Dialect>
+void BasicRcon<Dialect>::_schedule_reconnect()
+{
+	const reconnect_policy_t &policy = this->_reconnect_policy;
+	if (policy.max_attempts > 0 && this->_reconnect_attempts >= policy.max_attempts)
+	{
+		this->_logger->error("Failed to reconnect after " + std::to_string(this->_reconnect_attempts) + " attempts. Giving up.");
+		this->close();
+		return;
+	}
+
+	double delay = policy.initial_delay.count() * std::pow(policy.multiplier, this->_reconnect_attempts);
+	delay = std::min(delay, (double) policy.max_delay.count());
+	std::uniform_real_distribution<double> jitter(1.0 - policy.jitter, 1.0 + policy.jitter);
+	delay *= jitter(this->_jitter_rng);
+
+	this->_reconnect_attempts++;
+	this->_reconnect_at = std::chrono::steady_clock::now() + std::chrono::milliseconds((int64_t) delay);
+	this->_logger->debug([&] { return "Next reconnect attempt in " + std::to_string((int64_t) delay) + " ms"; });
+	if (this->_deadline_hook) this->_deadline_hook();
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_attempt_reconnect()
+{
+	this->_logger->info("Reconnecting to " + this->_rcon_addr.to_string() + " (attempt " + std::to_string(this->_reconnect_attempts) + ")");
+	this->_metrics.reconnect_attempts.add();
+	// A failed attempt schedules the next one by itself.
+	this->_start_connect();
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_finish_reconnect()
+{
+	this->_reconnecting = false;
+	this->_reconnect_attempts = 0;
+	this->_logger->info("Reconnected to " + this->_rcon_addr.to_string());
+	this->_metrics.reconnects.add();
+
+	// The queued commands only start timing out now.
+	auto now = std::chrono::steady_clock::now();
+	for (int32_t id = this->_oldest_id; id != this->_next_id; id = _following_id(id))
+	{
+		pending_command_t *pending = this->_inflight.find(id >> 1);
+		if (pending) pending->sent_at = now;
+	}
+
+	// The server runs requests in order, so authenticating in front of the queued commands lets them all go out together.
+	// The auth request gets the ID right before theirs, so that it is still the oldest request and the first to time out.
+	if (this->_has_password)
+	{
+		std::string queued = std::move(this->_out_buffer);
+		this->_out_buffer.clear();
+		this->_oldest_id = _preceding_id(this->_oldest_id);
+		this->_queue_as(this->_oldest_id, PACKET_TYPE::SERVERDATA_AUTH, this->_password, true, [this](bool success, std::string) {
+			if (success) return;
+			this->_logger->error("Failed to authenticate again after reconnecting.");
+			this->close();
+		});
+		this->_out_buffer.append(queued);
+	}
+
+	if (!this->_out_buffer.empty()) this->_send_pending();
+	if (this->_deadline_hook) this->_deadline_hook();
+}
+
+template <typename Dialect>
+bool BasicRcon<Dialect>::_poll_reconnect(std::chrono::milliseconds timeout)
+{
+	auto now = std::chrono::steady_clock::now();
+	if (!this->_connecting)
+	{
+		if (now < this->_reconnect_at)
+		{
+			std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(timeout, this->_reconnect_at - now));
+			now = std::chrono::steady_clock::now();
+			if (now < this->_reconnect_at) return true;
+		}
+		this->_attempt_reconnect();
+		if (!this->_connecting) return this->_connected || this->_reconnecting;
+	}
+
+	this->_wait_for_connect(timeout);
+	return this->_connected || this->_reconnecting;
+}
+
+template <typename Dialect>
+bool BasicRcon<Dialect>::authenticate(std::string &server_password)
 {
 	if (!this->_connected)
 	{
 		this->_logger->error("Socket not currently connected. Cannot authenticate.");
 		return false;
 	}
-	int packet_id = this->_default_dist(this->_rng);
-
-	std::string auth_packet;
-	uint32_t packet_len = server_password.length() + PACKET_PADDING_SIZE;
-	auth_packet += int_to_le_string(packet_len);
-	auth_packet += int_to_le_string(packet_id);
-	auth_packet += int_to_le_string((int32_t) PACKET_TYPE::SERVERDATA_AUTH);
-	auth_packet += server_password;
-	auth_packet += '\0';
-	auth_packet += '\0';
 
-	bool success = this->_send_data(auth_packet);
-	if (success) this->_logger->info("Authentication successful.");
-	else         this->_logger->error("Authentication failed.");
-	printf("auth packet success: %s\n", (success ? "true" : "false"));
-	std::map<uint32_t, std::vector<std::string>> data = this->get_pending_data();
+	bool finished = false;
+	bool authenticated = false;
+	this->authenticate_async(server_password, [&](bool success, std::string) {
+		finished = true;
+		authenticated = success;
+	});
+	while (!finished && this->poll(this->_sentinel_timeout)) {}
 
-	if (data.find(packet_id) != data.end() && data.at(packet_id).size() == 2)
+	if (authenticated)
 	{
 		this->_logger->info("Successfully authenticated to the remote RCON server at " + this->_rcon_addr.to_string());
 		return true;
@@ -106,143 +441,689 @@ bool Rcon::authenticate(std::string &server_password)
 	return false;
 }
 
-std::map<uint32_t, std::vector<std::string>> Rcon::get_pending_data()
+template <typename Dialect>
+void BasicRcon<Dialect>::authenticate_async(const std::string &server_password, CommandCallback callback)
+{
+	if (!this->_connected && !this->_reconnecting)
+	{
+		this->_logger->error("Socket not currently connected. Cannot authenticate.");
+		if (callback) callback(false, "");
+		return;
+	}
+	this->_password = server_password;
+	this->_has_password = true;
+	this->_submit(PACKET_TYPE::SERVERDATA_AUTH, server_password, true, std::move(callback));
+}
+
+template <typename Dialect>
+std::map<uint32_t, std::vector<std::string>> BasicRcon<Dialect>::get_pending_data()
 {
 	std::map<uint32_t, std::vector<std::string>> incoming_packets;
 	if (!this->_connected) return incoming_packets;
 
-	fd_set read_set;
-	FD_ZERO(&read_set);
-	FD_SET(this->_rcon_socket, &read_set);
-
-	struct timeval time_set;
-	time_set.tv_sec = 0;
-	time_set.tv_usec = 100 * 1000;
-
-	int ready;
+	this->_unclaimed = &incoming_packets;
 	int num_packets = 0;
 	int tries = 0;
 
-	while ((ready = select(this->_rcon_socket + 1, &read_set, NULL, NULL, &time_set))/* || tries < 3*/)
+	while (this->_connected)
 	{
+		int ready = this->_wait_for(POLLIN, this->_response_timeout);
+		if (ready == 0) break;
+
 		if (ready == -1 && tries == 2)
 		{
-			this->_logger->error("LIBC \"select\" error (" + std::to_string(errno) + "): " + strerror(errno));
+			this->_logger->error("LIBC \"poll\" error (" + std::to_string(errno) + "): " + strerror(errno));
 			this->_logger->error("Ran out of tries. Automatically disconnecting socket.");
-			close();
+			this->_connection_lost();
 			break;
 		}
 		else if (ready == -1)
 		{
-			this->_logger->error("LIBC \"select\" error (" + std::to_string(errno) + "): " + strerror(errno));
+			this->_logger->error("LIBC \"poll\" error (" + std::to_string(errno) + "): " + strerror(errno));
 			this->_logger->info("Trying again to read socket.");
 			tries++;
 			continue;
 		}
 
-		char read_buff[MAX_PACKET_LENGTH];
-		::recv(this->_rcon_socket, &read_buff, sizeof(read_buff), 0);
-		num_packets++;
+		if (this->_receive_data() < 0) break;
+		num_packets += this->_process_packets();
+	}
+	this->_unclaimed = nullptr;
+	this->_handle_timeout(std::chrono::steady_clock::now());
+
+	this->_logger->debug([&] { return "Successfully read " + std::to_string(num_packets) + (num_packets == 1 ? " packet." : " packets."); });
+	return incoming_packets;
+}
+
+template <typename Dialect>
+bool BasicRcon<Dialect>::poll(std::chrono::milliseconds timeout)
+{
+	if (this->_reconnecting && !this->_external_io) return this->_poll_reconnect(timeout);
+	if (!this->_connected) return false;
+
+	// Don't sleep past the point where the oldest request times out.
+	if (!this->_inflight.empty())
+	{
+		auto until_deadline = std::chrono::duration_cast<std::chrono::milliseconds>(this->_next_deadline() - std::chrono::steady_clock::now());
+		timeout = std::max(std::chrono::milliseconds(0), std::min(timeout, until_deadline + std::chrono::milliseconds(1)));
+	}
+
+	int ready = this->_wait_for(POLLIN, timeout);
+	if (ready == -1 && errno != EINTR)
+	{
+		this->_logger->error("LIBC \"poll\" error (" + std::to_string(errno) + "): " + strerror(errno));
+		this->_connection_lost();
+		return this->_reconnecting;
+	}
+	if (ready == 1 && this->_receive_data() > 0) this->_process_packets();
+
+	this->_handle_timeout(std::chrono::steady_clock::now());
+	return this->_connected || this->_reconnecting;
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::get_socket_status() {
+	// This costs a syscall and is only ever logged, so skip it entirely when nobody will see it.
+	if (!this->_logger->should_log(LOG_LEVEL::DEBUG)) return;
+
+	int error = 0;
+	socklen_t len = sizeof(error);
+	int result = getsockopt(this->_rcon_socket, SOL_SOCKET, SO_ERROR, &error, &len);
+	this->_logger->debug([&] { return "get_socket_status result: " + std::to_string(result) + " | error: " + std::to_string(error); });
+}
+
+template <typename Dialect>
+std::string BasicRcon<Dialect>::send_command(const std::string &command, PACKET_TYPE packet_type)
+{
+	this->get_socket_status();
+	if (!this->_connected && !this->_reconnecting)
+	{
+		this->_logger->error("Socket not currently connected. Socket must be connected to send data.");
+		return "";
+	}
+
+	bool finished = false;
+	std::string final_data = "";
+	this->send_command_async(command, [&](bool, std::string response) {
+		finished = true;
+		final_data = std::move(response);
+	}, packet_type);
+	while (!finished && this->poll(this->_sentinel_timeout)) {}
+
+	this->_logger->debug([&] {
+		if (final_data.length() == 0) return std::string("RESPONSE: (no response)");
 
-		uint32_t packet_id;
-		std::memcpy(&packet_id, read_buff + sizeof(uint32_t), sizeof(uint32_t));
-		packet_id = le32toh(packet_id);
-		
-		if (incoming_packets.find(packet_id) == incoming_packets.end())
+		std::string dump = "RESPONSE: ";
+		dump.reserve(dump.length() + final_data.length() * 4);
+		for (auto ch : final_data)
 		{
-			incoming_packets.emplace(packet_id, std::vector<std::string>());
+			dump += num_to_hex<uint8_t>(ch);
 		}
-		uint32_t packet_length;
-		std::memcpy(&packet_length, read_buff, sizeof(uint32_t));
-		incoming_packets.at(packet_id).push_back(std::string(read_buff + sizeof(uint32_t), le32toh(packet_length)));
+		return dump;
+	});
+	return final_data;
+}
+
+template <typename Dialect>
+bool BasicRcon<Dialect>::_can_send(const std::string &command)
+{
+	if (!this->_connected && !this->_reconnecting)
+	{
+		this->_logger->error("Socket not currently connected. Socket must be connected to send data.");
+		return false;
+	}
+	if (command.length() > Dialect::max_command_length)
+	{
+		this->_logger->error("Command is " + std::to_string(command.length()) + " bytes long, but the server accepts at most " + std::to_string(Dialect::max_command_length) + ".");
+		return false;
+	}
+	return true;
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::send_command_async(const std::string &command, CommandCallback callback, PACKET_TYPE packet_type)
+{
+	if (!this->_can_send(command))
+	{
+		if (callback) callback(false, "");
+		return;
 	}
+	this->_submit(packet_type, command, false, std::move(callback));
+}
+
+template <typename Dialect>
+bool BasicRcon<Dialect>::stream_command(const std::string &command, FragmentCallback on_fragment, PACKET_TYPE packet_type)
+{
+	bool finished = false;
+	bool succeeded = false;
+	this->stream_command_async(command, std::move(on_fragment), [&](bool success) {
+		finished = true;
+		succeeded = success;
+	}, packet_type);
+	while (!finished && this->poll(this->_sentinel_timeout)) {}
+	return succeeded;
+}
 
-	if (!ready && !num_packets) {
+template <typename Dialect>
+void BasicRcon<Dialect>::stream_command_async(const std::string &command, FragmentCallback on_fragment, StreamCallback on_complete, PACKET_TYPE packet_type)
+{
+	if (!this->_can_send(command))
+	{
+		if (on_complete) on_complete(false);
+		return;
+	}
+	CommandCallback callback = nullptr;
+	if (on_complete) callback = [on_complete = std::move(on_complete)](bool success, std::string) { on_complete(success); };
+	this->_submit(packet_type, command, false, std::move(callback), std::move(on_fragment));
+}
+
+template <typename Dialect>
+std::future<std::string> BasicRcon<Dialect>::send_command_async(const std::string &command, PACKET_TYPE packet_type)
+{
+	auto promise = std::make_shared<std::promise<std::string>>();
+	std::future<std::string> result = promise->get_future();
+	this->send_command_async(command, [promise](bool, std::string response) {
+		promise->set_value(std::move(response));
+	}, packet_type);
+	return result;
+}
+
+template <typename Dialect>
+std::vector<std::string> BasicRcon<Dialect>::send_batch(const std::vector<std::string_view> &commands)
+{
+	bool finished = false;
+	std::vector<std::string> results;
+	this->send_batch_async(commands, [&](bool, std::vector<std::string> responses) {
+		finished = true;
+		results = std::move(responses);
+	});
+	while (!finished && this->poll(this->_sentinel_timeout)) {}
+	return results;
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::send_batch_async(const std::vector<std::string_view> &commands, BatchCallback callback)
+{
+	if (!this->_connected && !this->_reconnecting)
+	{
+		this->_logger->error("Socket not currently connected. Socket must be connected to send data.");
+		if (callback) callback(false, std::vector<std::string>(commands.size()));
+		return;
+	}
+	if (commands.empty())
+	{
+		if (callback) callback(true, {});
+		return;
+	}
+	for (std::string_view command : commands)
+	{
+		if (command.length() > Dialect::max_command_length)
+		{
+			// Reject the whole batch before anything is sent, rather than leaving a gap in it.
+			this->_logger->error("Command is " + std::to_string(command.length()) + " bytes long, but the server accepts at most " + std::to_string(Dialect::max_command_length) + ".");
+			if (callback) callback(false, std::vector<std::string>(commands.size()));
+			return;
+		}
+	}
+
+	struct batch_state_t
+	{
+		std::vector<std::string> responses;
+		size_t remaining;
+		bool success = true;
+		BatchCallback callback;
+	};
+	auto batch = std::make_shared<batch_state_t>();
+	batch->responses.resize(commands.size());
+	batch->remaining = commands.size();
+	batch->callback = std::move(callback);
+
+	// Encode every command into the output buffer first, so that they all go out in as few writes as possible.
+	int32_t first_id = this->_next_id;
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		this->_queue(PACKET_TYPE::SERVERDATA_EXECCOMMAND, commands[i], false, [batch, i](bool success, std::string response) {
+			batch->responses[i] = std::move(response);
+			batch->success = batch->success && success;
+			if (--batch->remaining == 0 && batch->callback) batch->callback(batch->success, std::move(batch->responses));
+		});
+	}
+
+	if (!this->_send_pending())
+	{
+		for (int32_t id = first_id; id != this->_next_id; id = _following_id(id)) this->_complete(id, false);
+	}
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::close()
+{
+	bool was_reconnecting = this->_reconnecting;
+	this->_reconnecting = false;
+
+	if (this->_close_hook)
+	{
+		std::function<void()> hook = std::move(this->_close_hook);
+		this->_close_hook = nullptr;
+		hook();
+	}
+
+	this->_abandon_attempts();
+	if (this->_connected || this->_connecting || was_reconnecting)
+	{
+		::close(this->_rcon_socket);
+		if (this->_connected) this->_logger->info("Connection closed.");
+	}
+	this->_connected = false;
+	this->_connecting = false;
+	this->_framer.reset();
+	this->_out_buffer.clear();
+	this->_out_offset = 0;
+
+	// Nothing that is still in flight can be answered anymore.
+	for (int32_t id = this->_oldest_id; id != this->_next_id; id = _following_id(id))
+	{
+		if (this->_inflight.find(id >> 1)) this->_complete(id, false);
+	}
+	this->_oldest_id = this->_next_id;
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_submit(PACKET_TYPE packet_type, std::string_view body, bool is_auth, CommandCallback callback, FragmentCallback on_fragment)
+{
+	int32_t packet_id = this->_queue(packet_type, body, is_auth, std::move(callback), std::move(on_fragment));
+	if (!this->_send_pending()) this->_complete(packet_id, false);
+}
+
+template <typename Dialect>
+int32_t BasicRcon<Dialect>::_queue(PACKET_TYPE packet_type, std::string_view body, bool is_auth, CommandCallback callback, FragmentCallback on_fragment)
+{
+	int32_t packet_id = this->_next_id;
+	this->_next_id = _following_id(packet_id);
+	this->_queue_as(packet_id, packet_type, body, is_auth, std::move(callback), std::move(on_fragment));
+	return packet_id;
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_queue_as(int32_t packet_id, PACKET_TYPE packet_type, std::string_view body, bool is_auth, CommandCallback callback, FragmentCallback on_fragment)
+{
+	append_packet(this->_out_buffer, packet_id, (int32_t) packet_type, body);
+
+	// Follow the command with an empty response packet. The server echoes it back once it has finished
+	// responding to the command, which marks the end of a (possibly multi-packet) response.
+	// Auth requests always end with an auth response, so they don't need one, and neither do single packet responses.
+	bool use_sentinel = false;
+	if constexpr (!Dialect::single_packet_responses)
+	{
+		use_sentinel = !is_auth && this->_response_end == RESPONSE_END::SENTINEL && this->_sentinel_supported;
+	}
+	if (use_sentinel) append_packet(this->_out_buffer, packet_id + 1, (int32_t) PACKET_TYPE::SERVERDATA_RESPONSE_VALUE, "");
+
+	if (is_auth) this->_auth_id = packet_id;
+	else this->_metrics.commands_sent.add();
+
+	pending_command_t pending;
+	pending.callback = std::move(callback);
+	pending.on_fragment = std::move(on_fragment);
+	pending.sent_at = std::chrono::steady_clock::now();
+	pending.expects_sentinel = use_sentinel;
+	pending.is_auth = is_auth;
+	pending.received_data = false;
+	pending.packets = 0;
+	this->_inflight.insert(packet_id >> 1, std::move(pending));
+	if (this->_inflight.size() == 1 && this->_deadline_hook) this->_deadline_hook();
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_complete(int32_t packet_id, bool success)
+{
+	if (!this->_inflight.find(packet_id >> 1)) return;
+	pending_command_t pending = this->_inflight.take(packet_id >> 1);
+	if (success)
+	{
+		this->_failed_packets = 0;
+		// A response ends with its last packet, even when that is only noticed once the response timeout has passed.
+		auto latency = std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(this->_last_receive - pending.sent_at).count(), 0);
+		if (pending.is_auth)
+		{
+			this->_metrics.auth_latency.record(latency);
+		}
+		else
+		{
+			this->_metrics.command_rtt.record(latency);
+			this->_metrics.packets_per_response.record(pending.packets);
+		}
+	}
+	else
+	{
+		this->_metrics.commands_failed.add();
+	}
+	if (pending.callback) pending.callback(success, std::move(pending.response));
+}
+
+template <typename Dialect>
+std::chrono::steady_clock::time_point BasicRcon<Dialect>::_next_deadline()
+{
+	if (this->_connecting)
+	{
+		// Event loops only watch the socket of the first attempt, so lookups and the other attempts are checked on a short timer.
+		if (this->_resolving || !this->_attempts.empty()) return std::min(this->_connect_deadline(), std::chrono::steady_clock::now() + std::chrono::milliseconds(5));
+		return this->_connect_deadline();
+	}
+	if (this->_reconnecting) return this->_reconnect_at;
+
+	// Skip over requests that have already completed.
+	while (this->_oldest_id != this->_next_id && !this->_inflight.find(this->_oldest_id >> 1))
+	{
+		this->_oldest_id = _following_id(this->_oldest_id);
+	}
+	if (this->_oldest_id == this->_next_id) return std::chrono::steady_clock::time_point::max();
+
+	const pending_command_t *pending = this->_inflight.find(this->_oldest_id >> 1);
+	bool expects_end = pending->expects_sentinel || pending->is_auth;
+	return std::max(this->_last_receive, pending->sent_at) + (expects_end ? this->_sentinel_timeout : this->_response_timeout);
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_expire_requests(std::chrono::steady_clock::time_point now)
+{
+	// The server answers requests in order, so the oldest request is always the first one to time out.
+	while (this->_connected && this->_next_deadline() <= now)
+	{
+		int32_t packet_id = this->_oldest_id;
+		pending_command_t *pending = this->_inflight.find(packet_id >> 1);
+
+		if (pending->received_data && !pending->is_auth)
+		{
+			if (pending->expects_sentinel)
+			{
+				// The server answered the command but never echoed the sentinel, so it won't ever do so.
+				this->_logger->warn("The RCON server does not echo empty response packets. Falling back to timeout based reads.");
+				this->_sentinel_supported = false;
+			}
+			this->_complete(packet_id, true);
+			continue;
+		}
 
 		this->_logger->warn("Timeout limit reached.");
+		this->_metrics.timeouts.add();
+		this->_complete(packet_id, false);
 		if (++this->_failed_packets == 3) {
 			this->_logger->error("Too many failed packets. Closing connection...");
-			this->close();
+			this->_connection_lost();
 		}
-	} else {
-		this->_failed_packets = 0;
 	}
-	
-	this->_logger->debug("Successfully read " + std::to_string(num_packets) + (num_packets == 1 ? " packet." : " packets."));
-	return incoming_packets;
 }
 
-void Rcon::get_socket_status() {
-	int error = 0;
-	socklen_t len = sizeof(error);
-	int result = getsockopt(this->_rcon_socket, SOL_SOCKET, SO_ERROR, &error, &len);
-	this->_logger->debug("get_socket_status result: " + std::to_string(result) + " | error: " + std::to_string(error));
+template <typename Dialect>
+int BasicRcon<Dialect>::_process_packets()
+{
+	int num_packets = 0;
+	rcon_packet_t packet;
+	while (this->_framer.next(packet))
+	{
+		num_packets++;
+		this->_handle_packet(packet);
+	}
+	this->_metrics.packets_received.add(num_packets);
+
+	if (this->_framer.is_corrupt())
+	{
+		this->_logger->error("Received a malformed packet. Closing connection...");
+		this->_connection_lost();
+	}
+	return num_packets;
 }
 
-std::string Rcon::send_command(const std::string &command, Rcon::PACKET_TYPE packet_type)
+template <typename Dialect>
+void BasicRcon<Dialect>::_handle_packet(const rcon_packet_t &packet)
 {
-	this->get_socket_status();
-	if (!this->_connected)
+	this->_last_receive = std::chrono::steady_clock::now();
+
+	// Failed auth responses have an ID of -1, so match them to the auth request directly.
+	if (packet.type == (int32_t) PACKET_TYPE::SERVERDATA_AUTH_RESPONSE && this->_inflight.find(this->_auth_id >> 1))
 	{
-		this->_logger->error("Socket not currently connected. Socket must be connected to send data.");
-		return "";
+		if (packet.id != this->_auth_id) this->_metrics.auth_failures.add();
+		this->_complete(this->_auth_id, packet.id == this->_auth_id);
+		return;
 	}
 
-	int32_t packet_id = this->_default_dist(this->_rng);
-	packet_id = abs(packet_id);
+	if constexpr (Dialect::empty_packet_before_auth)
+	{
+		// The empty packet that precedes the auth response isn't part of any response.
+		if (packet.id == this->_auth_id && packet.body.empty() && packet.type == (int32_t) PACKET_TYPE::SERVERDATA_RESPONSE_VALUE) return;
+	}
 
-	uint32_t packet_length = command.length() + PACKET_PADDING_SIZE;
+	pending_command_t *pending = packet.id > 0 ? this->_inflight.find(packet.id >> 1) : nullptr;
+	if (pending && (packet.id & 1))
+	{
+		// The sentinel came back, so the command's response is complete.
+		this->_last_sentinel_id = packet.id;
+		this->_complete(packet.id - 1, true);
+		return;
+	}
+	if (pending)
+	{
+		pending->received_data = true;
+		pending->packets++;
+		bool complete = false;
+		if constexpr (Dialect::single_packet_responses) complete = !pending->is_auth;
+		if (pending->on_fragment)
+		{
+			// The callback may send more commands or close the session, either of which can move or remove the pending
+			// request, so it is held on to here and looked up again afterwards.
+			FragmentCallback on_fragment = std::move(pending->on_fragment);
+			on_fragment(packet.body);
+			pending = this->_inflight.find(packet.id >> 1);
+			if (!pending) return;
+			pending->on_fragment = std::move(on_fragment);
+		}
+		else
+		{
+			pending->response.append(packet.body);
+		}
+		if (complete) this->_complete(packet.id, true);
+		return;
+	}
 
-	std::string packet = int_to_le_string(packet_length);
-	packet += int_to_le_string(packet_id);
-	packet += int_to_le_string((int32_t) packet_type);
-	packet += command;
-	packet += '\x00';
-	packet += '\x00';
+	if (packet.id == this->_last_sentinel_id && packet.body == std::string_view("\x00\x01\x00\x00", 4))
+	{
+		this->_last_sentinel_id = 0;
+		return;
+	}
 
-	bool success = this->_send_data(packet);
-	if (!success) return "";
+	if (this->_dispatch_unsolicited(packet)) return;
+	if (this->_unclaimed) (*this->_unclaimed)[packet.id].emplace_back(packet.body);
+	else this->_logger->debug([&] { return "Dropped a packet with unknown ID " + std::to_string(packet.id); });
+}
 
-	std::map<uint32_t, std::vector<std::string>> received = get_pending_data();
-	if (received.find(packet_id) == received.end()) return "";
+template <typename Dialect>
+bool BasicRcon<Dialect>::_dispatch_unsolicited(const rcon_packet_t &packet)
+{
+	if (this->_subscriptions.empty()) return false;
 
-	std::vector<std::string> data_chunks = received.at(packet_id);
-	std::string final_data = "";
-	for (auto chunk : data_chunks)
+	// Handlers may subscribe, unsubscribe or close the session, so the matching ones are picked out first and each
+	// is looked up again right before it runs.
+	std::vector<uint64_t> matching;
+	for (const subscription_t &subscription : this->_subscriptions)
 	{
-		chunk = chunk.substr(sizeof(uint32_t) * 2);
-		final_data += chunk.substr(0, chunk.length() - 2);
+		if (subscription.any_id || subscription.packet_id == packet.id) matching.push_back(subscription.id);
 	}
-	this->_logger->print(LOG_LEVEL::DEBUG, "RESPONSE: ");
-	for (auto ch : final_data)
+
+	bool delivered = false;
+	for (uint64_t id : matching)
 	{
-		this->_logger->print(LOG_LEVEL::DEBUG, num_to_hex<uint8_t>(ch));
+		auto subscription = std::find_if(this->_subscriptions.begin(), this->_subscriptions.end(), [id](const subscription_t &entry) {
+			return entry.id == id;
+		});
+		if (subscription == this->_subscriptions.end()) continue;
+		PacketHandler handler = subscription->handler;
+		handler(packet);
+		delivered = true;
 	}
+	return delivered;
+}
 
-	if (final_data.length() == 0) this->_logger->print(LOG_LEVEL::DEBUG, "(no response)");
-	this->_logger->println(LOG_LEVEL::DEBUG, "");
-	return final_data;
+template <typename Dialect>
+uint64_t BasicRcon<Dialect>::subscribe(PacketHandler handler)
+{
+	uint64_t id = this->_next_subscription++;
+	this->_subscriptions.push_back(subscription_t{id, true, 0, std::move(handler)});
+	return id;
+}
+
+template <typename Dialect>
+uint64_t BasicRcon<Dialect>::subscribe(int32_t packet_id, PacketHandler handler)
+{
+	uint64_t id = this->_next_subscription++;
+	this->_subscriptions.push_back(subscription_t{id, false, packet_id, std::move(handler)});
+	return id;
 }
 
-bool Rcon::_send_data(const std::string &data)
+template <typename Dialect>
+void BasicRcon<Dialect>::unsubscribe(uint64_t subscription)
 {
-	fd_set write_set;
-	FD_ZERO(&write_set);
-	FD_SET(this->_rcon_socket, &write_set);
+	auto entry = std::find_if(this->_subscriptions.begin(), this->_subscriptions.end(), [subscription](const subscription_t &candidate) {
+		return candidate.id == subscription;
+	});
+	if (entry != this->_subscriptions.end()) this->_subscriptions.erase(entry);
+}
 
-	struct timeval timeout;
-	timeout.tv_sec = 1;
-	timeout.tv_usec = 0;
+template <typename Dialect>
+int BasicRcon<Dialect>::_wait_for(short events, std::chrono::milliseconds timeout)
+{
+	struct pollfd poll_fd;
+	poll_fd.fd = this->_rcon_socket;
+	poll_fd.events = events;
+	poll_fd.revents = 0;
 
-	int tries = 0;
-	int ready = 0;
+	return ::poll(&poll_fd, 1, timeout.count());
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_handle_io(uint32_t events)
+{
+	// Whatever is left of the old socket is of no interest while waiting for the next attempt.
+	if (this->_reconnecting && !this->_connecting) return;
+
+	if (this->_connecting)
+	{
+		// Until the first attempt has started, the socket is only a placeholder that isn't connecting anywhere.
+		if (!this->_primary_attempt || !(events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) || !this->_finish_connect()) return;
+	}
+
+	if (events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+	{
+		// The socket is edge triggered, so it has to be drained completely.
+		while (this->_connected && this->_receive_data() > 0) this->_process_packets();
+	}
+	if (this->_connected && (events & EPOLLOUT)) this->_flush();
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_handle_received(const char *data, ssize_t length)
+{
+	if (length == 0)
+	{
+		this->_logger->warn("The remote RCON server closed the connection.");
+		this->_connection_lost();
+		return;
+	}
+	if (length < 0)
+	{
+		this->_logger->error("io_uring \"recv\" error (" + std::to_string(-length) + "): " + strerror(-length));
+		this->_connection_lost();
+		return;
+	}
+
+	this->_metrics.bytes_received.add(length);
+	// The data has to be copied into the framer anyway, since packets may span several reads.
+	while (length > 0 && this->_connected)
+	{
+		size_t available;
+		char *destination = this->_framer.prepare(available);
+		size_t chunk = std::min<size_t>(available, length);
+		memcpy(destination, data, chunk);
+		this->_framer.commit(chunk);
+		data += chunk;
+		length -= chunk;
+		this->_process_packets();
+	}
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_handle_sent(ssize_t result, bool done)
+{
+	if (result < 0)
+	{
+		this->_logger->error("io_uring \"send\" error (" + std::to_string(-result) + "): " + strerror(-result));
+		this->_connection_lost();
+		return;
+	}
+	this->_metrics.bytes_sent.add(result);
+	// Whatever was queued while the write was in flight goes out next.
+	if (done) this->_flush();
+}
+
+template <typename Dialect>
+void BasicRcon<Dialect>::_handle_timeout(std::chrono::steady_clock::time_point now)
+{
+	if (this->_connecting)
+	{
+		this->_advance_connect(now);
+		return;
+	}
+	if (this->_reconnecting)
+	{
+		if (!this->_connecting && now >= this->_reconnect_at) this->_attempt_reconnect();
+		return;
+	}
+	this->_expire_requests(now);
+}
 
-	while (ready != 1 && tries < 3)
+template <typename Dialect>
+int BasicRcon<Dialect>::_receive_data()
+{
+	size_t available;
+	char *destination = this->_framer.prepare(available);
+
+	ssize_t bytes_read = ::recv(this->_rcon_socket, destination, available, 0);
+	if (bytes_read == 0)
+	{
+		this->_logger->warn("The remote RCON server closed the connection.");
+		this->_connection_lost();
+		return -1;
+	}
+	if (bytes_read < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+		this->_logger->error("LIBC \"recv\" error (" + std::to_string(errno) + "): " + strerror(errno));
+		this->_connection_lost();
+		return -1;
+	}
+
+	this->_framer.commit(bytes_read);
+	this->_metrics.bytes_received.add(bytes_read);
+	return 1;
+}
+
+template <typename Dialect>
+bool BasicRcon<Dialect>::_send_pending()
+{
+	// Everything stays queued until the connection is back.
+	if (!this->_connected) return this->_reconnecting;
+	if (!this->_flush()) return false;
+
+	// An event loop will finish the write once the socket becomes writable again.
+	if (this->_external_io) return true;
+
+	int tries = 0;
+	while (this->_out_offset < this->_out_buffer.length())
 	{
-		ready = select(this->_rcon_socket + 1, NULL, &write_set, NULL, &timeout);
-		if (ready == -1)
+		int ready = this->_wait_for(POLLOUT, std::chrono::milliseconds(1000));
+		if (ready == -1 && errno != EINTR)
 		{
-			this->_logger->error("LIBC \"select\" error (" + std::to_string(errno) + "): " + strerror(errno));
+			this->_logger->error("LIBC \"poll\" error (" + std::to_string(errno) + "): " + strerror(errno));
 			return false;
 		}
 		else if (ready == 0 && tries == 2)
@@ -256,27 +1137,45 @@ bool Rcon::_send_data(const std::string &data)
 			tries++;
 			continue;
 		}
+		if (!this->_flush()) return false;
 	}
+	return true;
+}
 
-	int bytes_sent = 0;
-	tries = 0;
+template <typename Dialect>
+bool BasicRcon<Dialect>::_flush()
+{
+	if (this->_write_hook)
+	{
+		if (this->_out_offset < this->_out_buffer.length()) this->_write_hook();
+		return true;
+	}
 
-	do {
-		bytes_sent = ::send(this->_rcon_socket, data.c_str(), data.length(), 0);
+	while (this->_out_offset < this->_out_buffer.length())
+	{
+		ssize_t bytes_sent = ::send(
+			this->_rcon_socket,
+			this->_out_buffer.data() + this->_out_offset,
+			this->_out_buffer.length() - this->_out_offset,
+			MSG_NOSIGNAL
+		);
 		if (bytes_sent < 0)
 		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+			if (errno == EINTR) continue;
 			this->_logger->error("LIBC \"send\" error (" + std::to_string(errno) + "): " + strerror(errno));
-			usleep(20000);
-			tries++;
+			this->_connection_lost();
+			return false;
 		}
-	} while (bytes_sent < 0 && tries < 3);
-	return bytes_sent > 0;
+		this->_out_offset += bytes_sent;
+		this->_metrics.bytes_sent.add(bytes_sent);
+	}
+
+	this->_out_buffer.clear();
+	this->_out_offset = 0;
+	return true;
 }
 
-std::string int_to_le_string(uint32_t number)
-{
-	char buffer[sizeof(uint32_t)];
-	number = htole32(number);
-	std::memcpy(&buffer, &number, sizeof(uint32_t));
-	return std::string(&buffer[0], sizeof(uint32_t));
-}
\ No newline at end of file
+#define CPP_RCON_DEFINE_SESSION(dialect) template class BasicRcon<dialect>;
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DEFINE_SESSION)
+#undef CPP_RCON_DEFINE_SESSION
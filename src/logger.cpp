@@ -1,5 +1,259 @@
 #include "logger.hpp"
 
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	/// Messages up to this length are stored inside the queue itself. Longer ones are moved to the heap.
+	constexpr size_t LOG_RECORD_MESSAGE_SIZE = 224;
+	constexpr size_t LOG_RECORD_LABEL_SIZE = 24;
+
+	typedef struct
+	{
+		int64_t timestamp;
+		LOG_LEVEL level;
+		bool header;
+		bool newline;
+		uint8_t label_length;
+		char label[LOG_RECORD_LABEL_SIZE];
+		uint16_t length;
+		char message[LOG_RECORD_MESSAGE_SIZE];
+		/// Only set if the message didn't fit into \ref message.
+		std::string *long_message;
+	} log_record_t;
+
+	/**
+	 * @brief A bounded multi-producer, single-consumer queue of log records plus the thread that writes them out.
+	 *
+	 * Each cell carries a sequence number that tells producers and the consumer whose turn it is,
+	 * so pushing a message only takes a single compare-and-swap on the enqueue position.
+	 */
+	class AsyncLogBackend
+	{
+	private:
+		typedef struct
+		{
+			std::atomic<size_t> sequence;
+			log_record_t record;
+		} cell_t;
+
+		std::unique_ptr<cell_t[]> _cells;
+		size_t _mask;
+		LOG_OVERFLOW _overflow;
+
+		alignas(64) std::atomic<size_t> _enqueue_pos{0};
+		alignas(64) std::atomic<size_t> _dequeue_pos{0};
+		std::atomic<size_t> _written{0};
+		std::atomic<size_t> _dropped{0};
+
+		std::atomic<bool> _running{true};
+		std::atomic<bool> _writer_sleeping{false};
+		std::mutex _wake_mutex;
+		std::condition_variable _wake;
+		std::thread _writer;
+
+		bool _pop(log_record_t &record)
+		{
+			size_t pos = this->_dequeue_pos.load(std::memory_order_relaxed);
+			cell_t &cell = this->_cells[pos & this->_mask];
+			if (cell.sequence.load(std::memory_order_acquire) != pos + 1) return false;
+
+			record = cell.record;
+			cell.sequence.store(pos + this->_mask + 1, std::memory_order_release);
+			this->_dequeue_pos.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		void _run()
+		{
+			std::string batch;
+			log_record_t record;
+
+			while (true)
+			{
+				batch.clear();
+				size_t count = 0;
+				while (count < 256 && this->_pop(record))
+				{
+					count++;
+					if (record.header) Logger::format_header(batch, record.timestamp, std::string(record.label, record.label_length), record.level);
+					if (record.long_message)
+					{
+						batch += *record.long_message;
+						delete record.long_message;
+					}
+					else batch.append(record.message, record.length);
+					if (record.newline) batch += '\n';
+				}
+
+				size_t dropped = this->_dropped.exchange(0, std::memory_order_relaxed);
+				if (dropped > 0)
+				{
+					Logger::format_header(batch, Logger::capture_timestamp(), "   LOGGER   ", LOG_LEVEL::WARNING);
+					batch += std::to_string(dropped) + " log messages were dropped because the queue was full.\n";
+				}
+
+				if (!batch.empty())
+				{
+					std::cout.write(batch.data(), batch.length());
+					std::cout.flush();
+					this->_written.fetch_add(count, std::memory_order_release);
+					continue;
+				}
+
+				if (!this->_running.load(std::memory_order_acquire)) break;
+
+				// Nothing to do. Producers only signal while this flag is set, and the timeout covers a missed signal.
+				std::unique_lock<std::mutex> lock(this->_wake_mutex);
+				this->_writer_sleeping.store(true, std::memory_order_seq_cst);
+				if (this->empty()) this->_wake.wait_for(lock, std::chrono::milliseconds(10));
+				this->_writer_sleeping.store(false, std::memory_order_relaxed);
+			}
+		}
+
+	public:
+		AsyncLogBackend(size_t capacity, LOG_OVERFLOW overflow) : _overflow(overflow)
+		{
+			size_t size = 2;
+			while (size < capacity) size *= 2;
+
+			this->_cells.reset(new cell_t[size]);
+			this->_mask = size - 1;
+			for (size_t i = 0; i < size; i++) this->_cells[i].sequence.store(i, std::memory_order_relaxed);
+
+			this->_writer = std::thread(&AsyncLogBackend::_run, this);
+		}
+
+		~AsyncLogBackend()
+		{
+			this->_running.store(false, std::memory_order_release);
+			this->_wake.notify_one();
+			if (this->_writer.joinable()) this->_writer.join();
+		}
+
+		bool empty() const
+		{
+			return this->_dequeue_pos.load(std::memory_order_acquire) == this->_enqueue_pos.load(std::memory_order_acquire);
+		}
+
+		/// The number of records that have been pushed so far.
+		size_t pushed() const { return this->_enqueue_pos.load(std::memory_order_acquire); }
+		/// The number of records that have been written out so far.
+		size_t written() const { return this->_written.load(std::memory_order_acquire); }
+
+		void push(LOG_LEVEL level, bool header, bool newline, const std::string &label, const std::string &output)
+		{
+			cell_t *cell;
+			size_t pos = this->_enqueue_pos.load(std::memory_order_relaxed);
+			while (true)
+			{
+				cell = &this->_cells[pos & this->_mask];
+				size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				intptr_t difference = (intptr_t) sequence - (intptr_t) pos;
+
+				if (difference == 0)
+				{
+					if (this->_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+				}
+				else if (difference < 0)
+				{
+					// The queue is full.
+					if (this->_overflow == LOG_OVERFLOW::DROP)
+					{
+						this->_dropped.fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+					std::this_thread::yield();
+					pos = this->_enqueue_pos.load(std::memory_order_relaxed);
+				}
+				else pos = this->_enqueue_pos.load(std::memory_order_relaxed);
+			}
+
+			log_record_t &record = cell->record;
+			record.timestamp = Logger::capture_timestamp();
+			record.level = level;
+			record.header = header;
+			record.newline = newline;
+			record.label_length = std::min(label.length(), LOG_RECORD_LABEL_SIZE);
+			std::memcpy(record.label, label.data(), record.label_length);
+			if (output.length() <= LOG_RECORD_MESSAGE_SIZE)
+			{
+				record.length = output.length();
+				std::memcpy(record.message, output.data(), output.length());
+				record.long_message = nullptr;
+			}
+			else record.long_message = new std::string(output);
+
+			cell->sequence.store(pos + 1, std::memory_order_release);
+
+			if (this->_writer_sleeping.load(std::memory_order_seq_cst)) this->_wake.notify_one();
+		}
+	};
+
+	std::mutex async_backend_mutex;
+	std::atomic<AsyncLogBackend *> async_backend{nullptr};
+	/// The number of threads that may be using the backend right now. It is only deleted once none are left.
+	std::atomic<size_t> async_users{0};
+
+	/**
+	 * @brief Keeps the asynchronous backend alive while it is in use.
+	 *
+	 * The count goes up before the backend is loaded, so @ref Logger::stop_async either sees this thread
+	 * and waits for it, or has already taken the backend away and this thread writes synchronously instead.
+	 */
+	class AsyncBackendRef
+	{
+	public:
+		AsyncLogBackend *backend;
+
+		AsyncBackendRef()
+		{
+			async_users.fetch_add(1, std::memory_order_seq_cst);
+			this->backend = async_backend.load(std::memory_order_seq_cst);
+		}
+
+		~AsyncBackendRef()
+		{
+			async_users.fetch_sub(1, std::memory_order_release);
+		}
+
+		AsyncBackendRef(const AsyncBackendRef &) = delete;
+		AsyncBackendRef &operator=(const AsyncBackendRef &) = delete;
+	};
+
+	std::atomic<TIMESTAMP_FORMAT> timestamp_format{TIMESTAMP_FORMAT::LOCAL};
+
+	/// Everything in a local timestamp except for the milliseconds, for the second that was formatted last.
+	typedef struct
+	{
+		std::time_t second = -1;
+		/// `mm/dd/yyyy hh:mm:ss.`
+		char prefix[32];
+		size_t prefix_length;
+		/// ` tz`
+		char suffix[16];
+		size_t suffix_length;
+	} timestamp_cache_t;
+
+	thread_local timestamp_cache_t timestamp_cache;
+
+	const char *level_names[] = {"DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL", "FATAL"};
+	const char *level_escape_seqs[] = {
+		"\033[38;5;248m", // gray
+		"\033[97m",       // white
+		"\033[38;5;220m", // yellow
+		"\033[38;5;9m",   // red
+		"\033[38;5;124m", // dark red
+		"\033[37;41m"     // white on red
+	};
+}
+
 std::string pad_spaces(const std::string &input, size_t desired_length)
 {
 	if (input.length() >= desired_length)
@@ -68,69 +322,173 @@ std::string log_level_to_escape_seq(LOG_LEVEL level)
 
 std::string Logger::get_timestamp()
 {
-	std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-
-	// Convert the time point to a time_t type (Unix timestamp)
-	std::time_t current_time = std::chrono::system_clock::to_time_t(now);
-
-	// Convert the time_t to a tm struct for formatting
-	std::tm time_info;
-	localtime_r(&current_time, &time_info);
-
-	// Extract individual components (month, day, year, hour, minute, second, millisecond)
-	int month = time_info.tm_mon + 1; // tm_mon is zero-based
-	int day = time_info.tm_mday;
-	int year = time_info.tm_year + 1900; // tm_year is years since 1900
-	int hour = time_info.tm_hour;
-	int minute = time_info.tm_min;
-	int second = time_info.tm_sec;
-	std::string time_zone(time_info.tm_zone);
-
-	// Get the fractional part in milliseconds of the current time in seconds.
-	long milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
-
-	// Format the time in this format: mm/dd/yyyy hh/mm/ss.mmm
-	std::stringstream formatted_time;
-	formatted_time << std::setfill('0');
-	formatted_time << std::setw(2) << month << "/";
-	formatted_time << std::setw(2) << day << "/";
-	formatted_time << year << " ";
-	formatted_time << std::setw(2) << hour << ":";
-	formatted_time << std::setw(2) << minute << ":";
-	formatted_time << std::setw(2) << second << ".";
-	formatted_time << std::setw(3) << milliseconds << " ";
-	formatted_time << time_zone;
-	return formatted_time.str();
+	char buffer[TIMESTAMP_BUFFER_SIZE];
+	return std::string(buffer, Logger::format_timestamp(buffer, Logger::capture_timestamp()));
+}
+
+std::string Logger::get_timestamp(std::chrono::system_clock::time_point time)
+{
+	char buffer[TIMESTAMP_BUFFER_SIZE];
+	int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	return std::string(buffer, Logger::format_timestamp(buffer, timestamp));
+}
+
+void Logger::set_timestamp_format(TIMESTAMP_FORMAT format)
+{
+	timestamp_format.store(format, std::memory_order_relaxed);
+}
+
+int64_t Logger::capture_timestamp()
+{
+	if (timestamp_format.load(std::memory_order_relaxed) == TIMESTAMP_FORMAT::MONOTONIC_NANOSECONDS)
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+size_t Logger::format_timestamp(char *buffer, int64_t timestamp)
+{
+	if (timestamp_format.load(std::memory_order_relaxed) != TIMESTAMP_FORMAT::LOCAL)
+		return std::to_chars(buffer, buffer + TIMESTAMP_BUFFER_SIZE, timestamp).ptr - buffer;
+
+	// Round towards negative infinity so that times before the epoch still get the right second.
+	std::time_t second = timestamp / 1000000000;
+	int64_t nanoseconds = timestamp % 1000000000;
+	if (nanoseconds < 0)
+	{
+		second--;
+		nanoseconds += 1000000000;
+	}
+
+	timestamp_cache_t &cache = timestamp_cache;
+	if (cache.second != second)
+	{
+		std::tm time_info;
+		localtime_r(&second, &time_info);
+
+		// Format the time in this format: mm/dd/yyyy hh:mm:ss.
+		cache.prefix_length = std::snprintf(
+			cache.prefix, sizeof(cache.prefix), "%02d/%02d/%d %02d:%02d:%02d.",
+			time_info.tm_mon + 1, // tm_mon is zero-based
+			time_info.tm_mday,
+			time_info.tm_year + 1900, // tm_year is years since 1900
+			time_info.tm_hour,
+			time_info.tm_min,
+			time_info.tm_sec
+		);
+		cache.prefix_length = std::min(cache.prefix_length, sizeof(cache.prefix) - 1);
+		cache.suffix_length = std::snprintf(cache.suffix, sizeof(cache.suffix), " %s", time_info.tm_zone);
+		cache.suffix_length = std::min(cache.suffix_length, sizeof(cache.suffix) - 1);
+		cache.second = second;
+	}
+
+	int milliseconds = nanoseconds / 1000000;
+	char *end = buffer;
+	std::memcpy(end, cache.prefix, cache.prefix_length);
+	end += cache.prefix_length;
+	*end++ = '0' + milliseconds / 100;
+	*end++ = '0' + milliseconds / 10 % 10;
+	*end++ = '0' + milliseconds % 10;
+	std::memcpy(end, cache.suffix, cache.suffix_length);
+	end += cache.suffix_length;
+	return end - buffer;
+}
+
+void Logger::format_header(std::string &output, int64_t timestamp, const std::string &label, LOG_LEVEL level)
+{
+	char time[TIMESTAMP_BUFFER_SIZE];
+	size_t time_length = Logger::format_timestamp(time, timestamp);
+	int level_index = static_cast<int>(level);
+
+	output += "[ ";
+	output.append(time, time_length);
+	output += " ][ ";
+	output += label;
+	output += " ][ \033[1m";
+	output += level_escape_seqs[level_index];
+	output += level_names[level_index];
+	output += "\033[0m ]: ";
 }
 
 void Logger::print_header(LOG_LEVEL level)
 {
-	std::string time = Logger::get_timestamp();
+	std::string header;
+	Logger::format_header(header, Logger::capture_timestamp(), this->_label, level);
+	std::cout.write(header.data(), header.length());
+}
+
+void Logger::start_async(size_t capacity, LOG_OVERFLOW overflow)
+{
+	std::lock_guard<std::mutex> lock(async_backend_mutex);
+	if (async_backend.load()) return;
+
+	static bool registered_exit_handler = false;
+	if (!registered_exit_handler)
+	{
+		std::atexit(Logger::stop_async);
+		registered_exit_handler = true;
+	}
 
-	std::cout << "[ " << time << " ]"
-			  << "[ " << this->_label << " ]"
-			  << "[ \033[1m" << log_level_to_escape_seq(level) << log_level_to_string(level) << "\033[0m ]: ";
+	std::cout.flush();
+	async_backend.store(new AsyncLogBackend(capacity, overflow), std::memory_order_release);
+}
+
+void Logger::stop_async()
+{
+	std::lock_guard<std::mutex> lock(async_backend_mutex);
+	AsyncLogBackend *backend = async_backend.exchange(nullptr, std::memory_order_seq_cst);
+	if (!backend) return;
+
+	// Threads that log from here on write synchronously. The ones that got hold of the backend before are waited for.
+	while (async_users.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+	// Deleting the backend drains the queue and joins the writer thread.
+	delete backend;
+}
+
+void Logger::flush()
+{
+	AsyncBackendRef ref;
+	AsyncLogBackend *backend = ref.backend;
+	if (!backend) return;
+
+	size_t target = backend->pushed();
+	while (backend->written() < target) std::this_thread::sleep_for(std::chrono::microseconds(100));
 }
 
 void Logger::print(LOG_LEVEL level, const std::string &output)
 {
-	if (level < this->log_level)
+	if (!this->should_log(level))
 		return;
-	if (this->_should_print_header)
+
+	{
+		AsyncBackendRef ref;
+		if (ref.backend)
+		{
+			ref.backend->push(level, this->_should_print_header.load(std::memory_order_relaxed), false, this->_label, output);
+			return;
+		}
+	}
+
+	if (this->_should_print_header.load(std::memory_order_relaxed))
 		this->print_header(level);
 	std::cout << output;
 };
 
 void Logger::println(LOG_LEVEL level, const std::string &output)
 {
-	if (level < this->log_level)
+	if (!this->should_log(level))
 		return;
-	std::string time = Logger::get_timestamp();
 
-	if (this->_should_print_header)
+	{
+		AsyncBackendRef ref;
+		if (ref.backend)
+		{
+			ref.backend->push(level, this->_should_print_header.exchange(true, std::memory_order_relaxed), true, this->_label, output);
+			return;
+		}
+	}
+
+	if (this->_should_print_header.exchange(true, std::memory_order_relaxed))
 		this->print_header(level);
-	else
-		this->_should_print_header = true;
 
 	std::cout << output << '\n';
 }
\ No newline at end of file
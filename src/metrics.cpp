@@ -0,0 +1,169 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+uint64_t histogram_snapshot_t::percentile(double fraction) const
+{
+	if (this->count == 0) return 0;
+
+	uint64_t target = (uint64_t) std::ceil(fraction * this->count);
+	uint64_t seen = 0;
+	for (size_t i = 0; i < this->bounds.size(); i++)
+	{
+		seen += this->buckets[i];
+		if (seen >= std::max<uint64_t>(target, 1)) return this->bounds[i];
+	}
+	return UINT64_MAX;
+}
+
+MetricHistogram::MetricHistogram(std::vector<uint64_t> bounds):
+	_bounds(std::move(bounds)),
+	_buckets(new MetricCounter[this->_bounds.size() + 1])
+{}
+
+void MetricHistogram::record(uint64_t value)
+{
+	size_t bucket = std::lower_bound(this->_bounds.begin(), this->_bounds.end(), value) - this->_bounds.begin();
+	this->_buckets[bucket].add();
+	this->_count.add();
+	this->_sum.add(value);
+}
+
+histogram_snapshot_t MetricHistogram::snapshot() const
+{
+	histogram_snapshot_t snapshot;
+	snapshot.bounds = this->_bounds;
+	snapshot.buckets.reserve(this->_bounds.size() + 1);
+	for (size_t i = 0; i <= this->_bounds.size(); i++) snapshot.buckets.push_back(this->_buckets[i].value());
+	snapshot.count = this->_count.value();
+	snapshot.sum = this->_sum.value();
+	return snapshot;
+}
+
+RconMetrics::RconMetrics():
+	// 100 us to 10 s, which spans everything from a loopback round trip to a server that is about to time out.
+	command_rtt({100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000}),
+	auth_latency({100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000}),
+	packets_per_response({1, 2, 4, 8, 16, 32, 64, 128, 256})
+{}
+
+session_metrics_t RconMetrics::snapshot() const
+{
+	session_metrics_t snapshot;
+	snapshot.commands_sent = this->commands_sent.value();
+	snapshot.commands_failed = this->commands_failed.value();
+	snapshot.timeouts = this->timeouts.value();
+	snapshot.bytes_sent = this->bytes_sent.value();
+	snapshot.bytes_received = this->bytes_received.value();
+	snapshot.packets_received = this->packets_received.value();
+	snapshot.auth_failures = this->auth_failures.value();
+	snapshot.connection_losses = this->connection_losses.value();
+	snapshot.reconnect_attempts = this->reconnect_attempts.value();
+	snapshot.reconnects = this->reconnects.value();
+	snapshot.command_rtt = this->command_rtt.snapshot();
+	snapshot.auth_latency = this->auth_latency.snapshot();
+	snapshot.packets_per_response = this->packets_per_response.snapshot();
+	return snapshot;
+}
+
+namespace
+{
+	std::string escape_label(const std::string &value)
+	{
+		std::string escaped;
+		escaped.reserve(value.length());
+		for (char ch : value)
+		{
+			if (ch == '\\') escaped += "\\\\";
+			else if (ch == '"') escaped += "\\\"";
+			else if (ch == '\n') escaped += "\\n";
+			else escaped += ch;
+		}
+		return escaped;
+	}
+
+	std::string format_number(double value)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%.9g", value);
+		return buffer;
+	}
+}
+
+std::string format_prometheus(const std::vector<std::pair<std::string, session_metrics_t>> &sessions)
+{
+	typedef struct
+	{
+		const char *name;
+		const char *help;
+		uint64_t session_metrics_t::*value;
+	} counter_family_t;
+
+	typedef struct
+	{
+		const char *name;
+		const char *help;
+		histogram_snapshot_t session_metrics_t::*value;
+		/// What the recorded values are divided by for export.
+		double scale;
+	} histogram_family_t;
+
+	static const counter_family_t counters[] = {
+		{"rcon_commands_sent_total", "Commands sent, not counting auth requests.", &session_metrics_t::commands_sent},
+		{"rcon_commands_failed_total", "Commands and auth requests that failed, including timeouts.", &session_metrics_t::commands_failed},
+		{"rcon_timeouts_total", "Requests that got no response in time.", &session_metrics_t::timeouts},
+		{"rcon_sent_bytes_total", "Bytes written to the server.", &session_metrics_t::bytes_sent},
+		{"rcon_received_bytes_total", "Bytes read from the server.", &session_metrics_t::bytes_received},
+		{"rcon_received_packets_total", "Packets read from the server.", &session_metrics_t::packets_received},
+		{"rcon_auth_failures_total", "Auth requests whose password was rejected.", &session_metrics_t::auth_failures},
+		{"rcon_connection_losses_total", "Connections that were lost after being established.", &session_metrics_t::connection_losses},
+		{"rcon_reconnect_attempts_total", "Attempts to re-establish a lost connection.", &session_metrics_t::reconnect_attempts},
+		{"rcon_reconnects_total", "Lost connections that were re-established.", &session_metrics_t::reconnects},
+	};
+	static const histogram_family_t histograms[] = {
+		{"rcon_command_rtt_seconds", "Time from sending a command to the last packet of its response.", &session_metrics_t::command_rtt, 1e6},
+		{"rcon_auth_latency_seconds", "Time from sending an auth request to its response.", &session_metrics_t::auth_latency, 1e6},
+		{"rcon_response_packets", "The number of packets each command's response was made of.", &session_metrics_t::packets_per_response, 1},
+	};
+
+	std::vector<std::string> labels;
+	labels.reserve(sessions.size());
+	for (const auto &session : sessions) labels.push_back("server=\"" + escape_label(session.first) + "\"");
+
+	std::string out;
+	for (const counter_family_t &family : counters)
+	{
+		out += std::string("# HELP ") + family.name + " " + family.help + "\n";
+		out += std::string("# TYPE ") + family.name + " counter\n";
+		for (size_t i = 0; i < sessions.size(); i++)
+		{
+			out += std::string(family.name) + "{" + labels[i] + "} " + std::to_string(sessions[i].second.*family.value) + "\n";
+		}
+	}
+
+	for (const histogram_family_t &family : histograms)
+	{
+		out += std::string("# HELP ") + family.name + " " + family.help + "\n";
+		out += std::string("# TYPE ") + family.name + " histogram\n";
+		for (size_t i = 0; i < sessions.size(); i++)
+		{
+			const histogram_snapshot_t &histogram = sessions[i].second.*family.value;
+			uint64_t cumulative = 0;
+			for (size_t bucket = 0; bucket < histogram.bounds.size(); bucket++)
+			{
+				cumulative += histogram.buckets[bucket];
+				out += std::string(family.name) + "_bucket{" + labels[i] + ",le=\"" + format_number(histogram.bounds[bucket] / family.scale) + "\"} " +
+					std::to_string(cumulative) + "\n";
+			}
+			// The buckets and the count are loaded separately while the session may still be recording, so the total is
+			// taken from the buckets themselves. Otherwise +Inf could come out below the last finite bucket.
+			cumulative += histogram.buckets.back();
+			out += std::string(family.name) + "_bucket{" + labels[i] + ",le=\"+Inf\"} " + std::to_string(cumulative) + "\n";
+			out += std::string(family.name) + "_sum{" + labels[i] + "} " + format_number(histogram.sum / family.scale) + "\n";
+			out += std::string(family.name) + "_count{" + labels[i] + "} " + std::to_string(cumulative) + "\n";
+		}
+	}
+	return out;
+}
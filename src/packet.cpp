@@ -0,0 +1,83 @@
+#include "packet.hpp"
+
+#include <algorithm>
+#include <endian.h>
+
+char *PacketFramer::prepare(size_t &available)
+{
+	// Everything before the read position has already been handed out, so move the unread tail to the front.
+	if (this->_read_pos > 0)
+	{
+		size_t unread = this->buffered();
+		if (unread > 0) std::memmove(this->_buffer.data(), this->_buffer.data() + this->_read_pos, unread);
+		this->_read_pos = 0;
+		this->_write_pos = unread;
+	}
+
+	// Make sure there is room for the rest of a partially received packet, and for at least one more maximum size packet.
+	size_t required = std::max(this->_pending_size, this->_write_pos + MAX_PACKET_LENGTH);
+	if (this->_buffer.size() < required)
+		this->_buffer.resize(std::max(required, this->_buffer.size() * 2));
+
+	available = this->_buffer.size() - this->_write_pos;
+	return this->_buffer.data() + this->_write_pos;
+}
+
+bool PacketFramer::next(rcon_packet_t &packet)
+{
+	if (this->_corrupt || this->buffered() < sizeof(int32_t)) return false;
+
+	const char *start = this->_buffer.data() + this->_read_pos;
+
+	int32_t packet_size;
+	std::memcpy(&packet_size, start, sizeof(int32_t));
+	packet_size = le32toh(packet_size);
+
+	if (packet_size < (int32_t) (PACKET_PADDING_SIZE) || (size_t) packet_size > this->_max_frame_length)
+	{
+		this->_corrupt = true;
+		return false;
+	}
+
+	if (this->buffered() < sizeof(int32_t) + packet_size)
+	{
+		// Remember how big the packet is so that the next call to prepare can make room for all of it.
+		this->_pending_size = sizeof(int32_t) + packet_size;
+		return false;
+	}
+
+	std::memcpy(&packet.id, start + sizeof(int32_t), sizeof(int32_t));
+	std::memcpy(&packet.type, start + sizeof(int32_t) * 2, sizeof(int32_t));
+	packet.id = le32toh(packet.id);
+	packet.type = le32toh(packet.type);
+	packet.body = std::string_view(start + sizeof(int32_t) * 3, packet_size - (PACKET_PADDING_SIZE));
+
+	this->_read_pos += sizeof(int32_t) + packet_size;
+	this->_pending_size = 0;
+	return true;
+}
+
+char *encode_packet(char *destination, int32_t id, int32_t type, std::string_view body)
+{
+	int32_t header[3] = {
+		(int32_t) htole32(body.length() + PACKET_PADDING_SIZE),
+		(int32_t) htole32(id),
+		(int32_t) htole32(type)
+	};
+	std::memcpy(destination, header, sizeof(header));
+	destination += sizeof(header);
+
+	if (!body.empty()) std::memcpy(destination, body.data(), body.length());
+	destination += body.length();
+
+	*destination++ = '\0';
+	*destination++ = '\0';
+	return destination;
+}
+
+void append_packet(std::string &buffer, int32_t id, int32_t type, std::string_view body)
+{
+	size_t offset = buffer.length();
+	buffer.resize(offset + encoded_packet_size(body.length()));
+	encode_packet(buffer.data() + offset, id, type, body);
+}
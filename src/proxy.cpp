@@ -0,0 +1,90 @@
+#include "proxy.hpp"
+
+RconProxy::RconProxy(RconReactor &reactor, rcon_addr_t upstream, std::string upstream_password, std::string password):
+	_reactor(reactor),
+	_logger(new Logger(" RCON PROXY ", LOG_LEVEL::INFO)),
+	_server(reactor, std::move(password)),
+	_upstream(upstream),
+	_upstream_password(std::move(upstream_password))
+{
+	this->_upstream.set_log_level(LOG_LEVEL::WARNING);
+	this->_server.on_command([this](std::string_view command, RconServer::Responder respond) {
+		this->_forward(command, respond);
+	});
+}
+
+bool RconProxy::listen(uint16_t port, const std::string &ip)
+{
+	if (!this->_server.listen(port, ip)) return false;
+	this->_logger->info("Proxying " + ip + ":" + std::to_string(this->_server.port()) + " to " + this->_upstream.address().to_string());
+	this->_connect_upstream();
+	return true;
+}
+
+void RconProxy::close()
+{
+	this->_server.close();
+	this->_state = UPSTREAM_STATE::DISCONNECTED;
+	this->_upstream.close();
+
+	for (auto &queued : this->_waiting) queued.respond.disconnect();
+	this->_waiting.clear();
+}
+
+void RconProxy::_connect_upstream()
+{
+	if (this->_state == UPSTREAM_STATE::CONNECTING) return;
+	this->_state = UPSTREAM_STATE::CONNECTING;
+
+	bool added = this->_reactor.add_session(this->_upstream, this->_upstream_password, [this](Rcon &, bool success) {
+		if (this->_state != UPSTREAM_STATE::CONNECTING) return;
+		if (!success)
+		{
+			this->_logger->error("Failed to connect to the upstream RCON server.");
+			this->_state = UPSTREAM_STATE::DISCONNECTED;
+			this->_upstream.close();
+
+			// Nothing is retried until the next command arrives, so a server that is down isn't hammered with connection attempts.
+			std::deque<queued_command_t> failed = std::move(this->_waiting);
+			this->_waiting.clear();
+			for (auto &queued : failed) queued.respond.disconnect();
+			return;
+		}
+
+		this->_logger->info("Connected to the upstream RCON server.");
+		this->_state = UPSTREAM_STATE::READY;
+		std::deque<queued_command_t> waiting = std::move(this->_waiting);
+		this->_waiting.clear();
+		for (auto &queued : waiting) this->_forward(queued.command, queued.respond);
+	});
+
+	// A failure to even start connecting has already been reported through the callback.
+	if (!added) this->_state = UPSTREAM_STATE::DISCONNECTED;
+}
+
+void RconProxy::_forward(std::string_view command, RconServer::Responder respond)
+{
+	if (this->_state == UPSTREAM_STATE::READY && !this->_upstream.is_connected())
+	{
+		this->_logger->warn("Lost the connection to the upstream RCON server. Reconnecting...");
+		this->_state = UPSTREAM_STATE::DISCONNECTED;
+	}
+
+	if (this->_state != UPSTREAM_STATE::READY)
+	{
+		this->_waiting.push_back({std::string(command), respond});
+		this->_connect_upstream();
+		return;
+	}
+
+	this->_upstream.send_command_async(std::string(command), [this, respond](bool success, std::string response) {
+		if (success)
+		{
+			respond(response);
+			return;
+		}
+		// An empty response would look like the command ran and printed nothing.
+		this->_logger->warn("A command failed upstream. Disconnecting the client that sent it.");
+		respond.disconnect();
+	});
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <boost/program_options.hpp>
+
+#include "proxy.hpp"
+
+namespace po = boost::program_options;
+
+std::string help_text =
+	"Usage: rcon-proxy [OPTIONS]\n\n"
+
+	"	Shares one authenticated connection to a remote RCON server between any number\n"
+	"	of local RCON clients, which connect to the proxy instead of the server.\n\n";
+
+int main(int argc, char *argv[])
+{
+	rcon_addr_t server_address{"127.0.0.1", 27015};
+	std::string server_password;
+	std::string listen_ip;
+	uint16_t listen_port;
+	std::string proxy_password;
+	std::string backend_name;
+
+	po::options_description ops_desc("Options");
+	ops_desc.add_options()
+		("help,h", "Displays this help screen and exits.")
+		("ip,i", po::value<std::string>(&server_address.ip)->default_value("127.0.0.1"), "The remote IP address of the RCON server.")
+		("port,p", po::value<uint16_t>(&server_address.port)->default_value(27015), "The port that the server is listening on.")
+		("password,P", po::value<std::string>(&server_password)->default_value(""), "The password of the RCON server.")
+		("listen-ip", po::value<std::string>(&listen_ip)->default_value("127.0.0.1"), "The local IPv4 address to accept clients on.")
+		("listen-port,l", po::value<uint16_t>(&listen_port)->default_value(27016), "The local port to accept clients on.")
+		("proxy-password", po::value<std::string>(&proxy_password), "The password clients authenticate to the proxy with. Defaults to the server's password.")
+		("backend", po::value<std::string>(&backend_name)->default_value("auto"), "How sockets are driven: \"epoll\", \"io_uring\", or \"auto\" to use io_uring where it is available.")
+		("verbose,v", "Logs every connection and disconnection.");
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, ops_desc), vm);
+	po::notify(vm);
+
+	if (vm.count("help")) {
+		std::cout << help_text << ops_desc << std::endl;
+		return 0;
+	}
+
+	if (!vm.count("proxy-password")) proxy_password = server_password;
+
+	REACTOR_BACKEND backend;
+	if (!parse_reactor_backend(backend_name, backend)) {
+		std::cerr << "Unknown backend \"" << backend_name << "\"." << std::endl;
+		return 1;
+	}
+
+	RconReactor reactor(256, backend);
+	RconProxy proxy(reactor, server_address, server_password, proxy_password);
+	proxy.set_log_level(vm.count("verbose") ? LOG_LEVEL::DEBUG : LOG_LEVEL::INFO);
+	if (!proxy.listen(listen_port, listen_ip)) return 1;
+
+	reactor.run();
+}
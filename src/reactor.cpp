@@ -0,0 +1,560 @@
+#include "reactor.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <unistd.h>
+
+namespace
+{
+	/// The user data of io_uring operations holds the file descriptor in its low bits, so it can't be any bigger.
+	const int MAX_URING_FD = (1 << 24) - 1;
+}
+
+bool parse_reactor_backend(const std::string &name, REACTOR_BACKEND &backend)
+{
+	static const std::pair<const char *, REACTOR_BACKEND> names[] = {
+		{"auto", REACTOR_BACKEND::AUTO},
+		{"epoll", REACTOR_BACKEND::EPOLL},
+		{"io_uring", REACTOR_BACKEND::IO_URING},
+	};
+	for (const auto &entry : names)
+	{
+		if (name == entry.first)
+		{
+			backend = entry.second;
+			return true;
+		}
+	}
+	return false;
+}
+
+RconReactor::RconReactor(size_t max_events, REACTOR_BACKEND backend):
+	_logger(new Logger("RCON REACTOR", LOG_LEVEL::WARNING)),
+	_backend(REACTOR_BACKEND::EPOLL),
+	_events(max_events)
+{
+	if (backend != REACTOR_BACKEND::EPOLL)
+	{
+		unsigned entries = (unsigned) std::clamp<size_t>(max_events, 64, 4096);
+		auto uring = std::make_unique<IoUring>(entries, std::max<unsigned>(entries, 256), MAX_PACKET_LENGTH * 2);
+		if (uring->is_ready())
+		{
+			this->_uring = std::move(uring);
+			this->_backend = REACTOR_BACKEND::IO_URING;
+			return;
+		}
+		if (backend == REACTOR_BACKEND::IO_URING) this->_logger->warn(uring->error() + " Falling back to epoll.");
+		else this->_logger->debug([&] { return uring->error() + " Using epoll."; });
+	}
+
+	this->_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (this->_epoll_fd < 0)
+	{
+		this->_logger->fatal("LIBC \"epoll_create1\" error (" + std::to_string(errno) + "): " + strerror(errno));
+	}
+}
+
+RconReactor::~RconReactor()
+{
+	// Detach every session so that closing them later doesn't call back into this reactor.
+	for (auto &watch : this->_watches)
+	{
+		if (watch && watch->session) watch->ops->detach(watch->session);
+	}
+	// Closing the ring cancels everything in flight, which has to happen before any send buffers are freed.
+	this->_uring.reset();
+	if (this->_epoll_fd >= 0) ::close(this->_epoll_fd);
+}
+
+template <typename Dialect>
+bool RconReactor::add_session(BasicRcon<Dialect> &session, SessionCallback<Dialect> on_connected)
+{
+	struct session_state_t
+	{
+		SessionCallback<Dialect> on_connected;
+		bool reported = false;
+	};
+	auto state = std::make_shared<session_state_t>();
+	state->on_connected = std::move(on_connected);
+
+	BasicRcon<Dialect> *rcon = &session;
+	auto report = [state, rcon](bool success) {
+		if (state->reported) return;
+		state->reported = true;
+		if (state->on_connected) state->on_connected(*rcon, success);
+	};
+
+	if (!session._connected && !session._connecting && !session._start_connect())
+	{
+		report(false);
+		return false;
+	}
+
+	int fd = session._rcon_socket;
+	auto watch = std::make_shared<watch_t>();
+	watch->session = rcon;
+	watch->ops = &_session_ops<Dialect>;
+	watch->timer_at = std::chrono::steady_clock::time_point::max();
+	watch->on_event = [rcon](uint32_t events) { rcon->_handle_io(events); };
+
+	if (!this->_add(fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, watch))
+	{
+		report(false);
+		return false;
+	}
+
+	session._external_io = true;
+	session._close_hook = [this, fd, rcon, report]() {
+		this->unwatch(fd);
+		rcon->_deadline_hook = nullptr;
+		rcon->_socket_hook = nullptr;
+		rcon->_connect_hook = nullptr;
+		rcon->_write_hook = nullptr;
+		rcon->_external_io = false;
+		report(false);
+	};
+	uint32_t generation = watch->generation;
+	session._deadline_hook = [this, fd, generation]() {
+		std::shared_ptr<watch_t> watch = this->_find(fd, generation);
+		if (watch) this->_schedule(fd, *watch);
+	};
+	session._socket_hook = [this, fd, generation]() { this->_rearm(fd, generation); };
+	if (this->_uring)
+	{
+		session._write_hook = [this, fd, generation, rcon]() { this->_send(fd, generation, rcon->_out_buffer, rcon->_out_offset); };
+	}
+	// Connections may complete from a timer as well as from an event, so the session reports it itself.
+	session._connect_hook = [report]() { report(true); };
+
+	this->_schedule(fd, *watch);
+	if (session._connected) report(true);
+	return true;
+}
+
+template <typename Dialect>
+bool RconReactor::add_session(BasicRcon<Dialect> &session, const std::string &password, SessionCallback<Dialect> on_ready)
+{
+	return this->add_session(session, [password, on_ready](BasicRcon<Dialect> &rcon, bool connected) {
+		if (!connected)
+		{
+			if (on_ready) on_ready(rcon, false);
+			return;
+		}
+		rcon.authenticate_async(password, [&rcon, on_ready](bool success, std::string) {
+			if (on_ready) on_ready(rcon, success);
+		});
+	});
+}
+
+template <typename Dialect>
+void RconReactor::remove_session(BasicRcon<Dialect> &session)
+{
+	if (!session._external_io) return;
+	_detach_session<Dialect>(&session);
+	this->unwatch(session._rcon_socket);
+}
+
+template <typename Dialect>
+const RconReactor::session_ops_t RconReactor::_session_ops = {
+	[](void *session) { return ((BasicRcon<Dialect> *) session)->_next_deadline(); },
+	[](void *session, std::chrono::steady_clock::time_point now) { ((BasicRcon<Dialect> *) session)->_handle_timeout(now); },
+	_detach_session<Dialect>,
+	[](void *session) {
+		BasicRcon<Dialect> *rcon = (BasicRcon<Dialect> *) session;
+		if (rcon->_connected) return SOCKET_STATE::CONNECTED;
+		// Until an attempt has been moved onto the socket, it is only a placeholder that isn't connecting anywhere.
+		if (rcon->_connecting && rcon->_primary_attempt) return SOCKET_STATE::CONNECTING;
+		return SOCKET_STATE::IDLE;
+	},
+	[](void *session, const char *data, ssize_t length) { ((BasicRcon<Dialect> *) session)->_handle_received(data, length); },
+	[](void *session, ssize_t result, bool done) { ((BasicRcon<Dialect> *) session)->_handle_sent(result, done); },
+};
+
+template <typename Dialect>
+void RconReactor::_detach_session(void *session)
+{
+	BasicRcon<Dialect> *rcon = (BasicRcon<Dialect> *) session;
+	rcon->_close_hook = nullptr;
+	rcon->_deadline_hook = nullptr;
+	rcon->_socket_hook = nullptr;
+	rcon->_connect_hook = nullptr;
+	rcon->_write_hook = nullptr;
+	rcon->_external_io = false;
+}
+
+bool RconReactor::watch(int fd, uint32_t events, EventHandler handler)
+{
+	auto watch = std::make_shared<watch_t>();
+	watch->on_event = std::move(handler);
+	watch->session = nullptr;
+	watch->ops = nullptr;
+	watch->timer_at = std::chrono::steady_clock::time_point::max();
+	return this->_add(fd, events, watch);
+}
+
+bool RconReactor::modify(int fd, uint32_t events)
+{
+	if (fd < 0 || (size_t) fd >= this->_watches.size() || !this->_watches[fd]) return false;
+
+	if (this->_uring)
+	{
+		watch_t &watch = *this->_watches[fd];
+		watch.events = events;
+		this->_disarm(fd, watch);
+		this->_sync(fd, watch);
+		return true;
+	}
+
+	struct epoll_event event;
+	event.events = events;
+	event.data.u64 = ((uint64_t) this->_watches[fd]->generation << 32) | (uint32_t) fd;
+	return epoll_ctl(this->_epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void RconReactor::unwatch(int fd)
+{
+	if (fd < 0 || (size_t) fd >= this->_watches.size() || !this->_watches[fd]) return;
+
+	if (this->_uring)
+	{
+		watch_t &watch = *this->_watches[fd];
+		this->_disarm(fd, watch);
+		if (watch.send_in_flight) this->_retired_sends.emplace_back(_user_data(fd, watch, URING_OP::SEND, watch.send_arm), std::move(watch.send_buffer));
+		// The descriptor is about to be closed and may be reused straight away, so the cancellations can't wait.
+		this->_uring->submit();
+	}
+	else
+	{
+		epoll_ctl(this->_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+	this->_watches[fd].reset();
+	this->_watch_count--;
+}
+
+int RconReactor::run_once(std::chrono::milliseconds timeout)
+{
+	// Don't sleep past the next session timeout.
+	if (!this->_deadlines.empty())
+	{
+		auto until_deadline = std::chrono::duration_cast<std::chrono::milliseconds>(this->_deadlines.top().at - std::chrono::steady_clock::now());
+		timeout = std::max(std::chrono::milliseconds(0), std::min(timeout, until_deadline + std::chrono::milliseconds(1)));
+	}
+
+	int count = this->_uring ? this->_run_uring(timeout) : this->_run_epoll(timeout);
+	if (count >= 0) this->_run_timers(std::chrono::steady_clock::now());
+	return count;
+}
+
+int RconReactor::_run_epoll(std::chrono::milliseconds timeout)
+{
+	int count = epoll_wait(this->_epoll_fd, this->_events.data(), this->_events.size(), timeout.count());
+	if (count < 0)
+	{
+		if (errno == EINTR) return 0;
+		this->_logger->error("LIBC \"epoll_wait\" error (" + std::to_string(errno) + "): " + strerror(errno));
+		return -1;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		int fd = (int) (this->_events[i].data.u64 & 0xFFFFFFFF);
+		uint32_t generation = (uint32_t) (this->_events[i].data.u64 >> 32);
+
+		// An earlier handler in this round may have removed or replaced the watch.
+		std::shared_ptr<watch_t> watch = this->_find(fd, generation);
+		if (!watch) continue;
+
+		watch->on_event(this->_events[i].events);
+		if (watch->session && this->_find(fd, generation)) this->_schedule(fd, *watch);
+	}
+	return count;
+}
+
+int RconReactor::_run_uring(std::chrono::milliseconds timeout)
+{
+	// Everything queued since the last round goes out with the same system call that waits for the next one.
+	int result = this->_uring->submit_and_wait(timeout);
+	if (result < 0 && result != -EBUSY && result != -EAGAIN)
+	{
+		this->_logger->error("LIBC \"io_uring_enter\" error (" + std::to_string(-result) + "): " + strerror(-result));
+		return -1;
+	}
+
+	int count = 0;
+	uring_completion_t completion;
+	while (this->_uring->next(completion))
+	{
+		count++;
+		this->_complete(completion);
+	}
+	return count;
+}
+
+uint64_t RconReactor::_user_data(int fd, const watch_t &watch, URING_OP op, uint8_t arm)
+{
+	return ((uint64_t) watch.generation << 32) | ((uint64_t) (arm & 0x3F) << 26) | ((uint64_t) op << 24) | (uint64_t) fd;
+}
+
+void RconReactor::_complete(const uring_completion_t &completion)
+{
+	int fd = (int) (completion.user_data & MAX_URING_FD);
+	URING_OP op = (URING_OP) ((completion.user_data >> 24) & 0x3);
+	uint8_t arm = (uint8_t) ((completion.user_data >> 26) & 0x3F);
+	uint32_t generation = (uint32_t) (completion.user_data >> 32);
+
+	std::shared_ptr<watch_t> watch = this->_find(fd, generation);
+	bool current = watch && arm == watch->arm;
+	bool connected = watch && watch->session && watch->ops->socket_state(watch->session) == SOCKET_STATE::CONNECTED;
+
+	switch (op)
+	{
+		case URING_OP::POLL:
+			if (!current) break;
+			if (!completion.more) watch->poll_armed = false;
+			if (completion.result >= 0) watch->on_event((uint32_t) completion.result);
+			else if (completion.result != -ECANCELED) watch->on_event(EPOLLERR);
+			break;
+
+		case URING_OP::RECEIVE:
+			if (current)
+			{
+				if (!completion.more) watch->receive_armed = false;
+				if (completion.result == -EINVAL && this->_multishot_receive)
+				{
+					this->_logger->warn("The kernel doesn't support multishot receives (Linux 6.0+). Falling back to single receives.");
+					this->_multishot_receive = false;
+				}
+				else if (completion.result != -ENOBUFS && connected)
+				{
+					// Running out of buffers only ends the receive, which is submitted again below.
+					const char *data = completion.has_buffer ? this->_uring->buffer(completion.buffer) : nullptr;
+					watch->ops->on_received(watch->session, data, completion.result);
+				}
+			}
+			// Buffers are handed back even for stale completions, or the ring would slowly run dry.
+			if (completion.has_buffer) this->_uring->recycle(completion.buffer);
+			break;
+
+		case URING_OP::SEND:
+		{
+			if (!watch)
+			{
+				auto retired = std::find_if(this->_retired_sends.begin(), this->_retired_sends.end(), [&](const auto &entry) {
+					return entry.first == completion.user_data;
+				});
+				if (retired != this->_retired_sends.end()) this->_retired_sends.erase(retired);
+				break;
+			}
+
+			bool done = true;
+			if (completion.result > 0 && watch->send_arm == arm)
+			{
+				watch->send_offset += completion.result;
+				done = watch->send_offset >= watch->send_buffer.length();
+			}
+			if (done)
+			{
+				watch->send_in_flight = false;
+				watch->send_buffer.clear();
+				watch->send_offset = 0;
+			}
+			else
+			{
+				this->_submit_send(fd, *watch);
+			}
+			// Writes to a socket that has since been replaced are of no interest anymore, except that the next one can go.
+			if (connected) watch->ops->on_sent(watch->session, watch->send_arm == arm || !done ? completion.result : 0, done);
+			break;
+		}
+
+		case URING_OP::CANCEL:
+			break;
+	}
+
+	if (watch && this->_find(fd, generation))
+	{
+		this->_sync(fd, *watch);
+		if (watch->session) this->_schedule(fd, *watch);
+	}
+}
+
+void RconReactor::_sync(int fd, watch_t &watch)
+{
+	if (!watch.session)
+	{
+		// Edge triggered watches map onto a multishot poll. Level triggered ones are polled once per event, since
+		// polling checks the current state of the descriptor.
+		if (!watch.poll_armed) watch.poll_armed = this->_uring->poll(_user_data(fd, watch, URING_OP::POLL, watch.arm), fd, watch.events & ~EPOLLET, watch.events & EPOLLET);
+		return;
+	}
+
+	SOCKET_STATE state = watch.ops->socket_state(watch.session);
+	if (state == SOCKET_STATE::CONNECTED && !watch.receive_armed)
+	{
+		watch.receive_armed = this->_uring->receive(_user_data(fd, watch, URING_OP::RECEIVE, watch.arm), fd, this->_multishot_receive);
+	}
+	if (state == SOCKET_STATE::CONNECTING && !watch.poll_armed)
+	{
+		watch.poll_armed = this->_uring->poll(_user_data(fd, watch, URING_OP::POLL, watch.arm), fd, EPOLLOUT, false);
+	}
+	// A write that is still queued must reach the kernel before a reconnect can put a new connection behind the descriptor.
+	if (state != SOCKET_STATE::CONNECTED && watch.send_in_flight) this->_uring->submit();
+}
+
+void RconReactor::_disarm(int fd, watch_t &watch)
+{
+	if (watch.poll_armed) this->_uring->cancel(_user_data(fd, watch, URING_OP::CANCEL, watch.arm), _user_data(fd, watch, URING_OP::POLL, watch.arm));
+	if (watch.receive_armed) this->_uring->cancel(_user_data(fd, watch, URING_OP::CANCEL, watch.arm), _user_data(fd, watch, URING_OP::RECEIVE, watch.arm));
+	watch.poll_armed = false;
+	watch.receive_armed = false;
+	watch.arm = (watch.arm + 1) & 0x3F;
+}
+
+void RconReactor::_send(int fd, uint32_t generation, std::string &out_buffer, size_t &out_offset)
+{
+	std::shared_ptr<watch_t> watch = this->_find(fd, generation);
+	// A send in flight picks up whatever was queued meanwhile once it completes.
+	if (!watch || watch->send_in_flight) return;
+
+	// Swapping hands the session back the empty buffer of the last send, so neither side ever has to allocate.
+	watch->send_buffer.clear();
+	std::swap(watch->send_buffer, out_buffer);
+	watch->send_offset = out_offset;
+	out_offset = 0;
+	watch->send_arm = watch->arm;
+	this->_submit_send(fd, *watch);
+}
+
+void RconReactor::_submit_send(int fd, watch_t &watch)
+{
+	watch.send_in_flight = true;
+	if (this->_uring->send(_user_data(fd, watch, URING_OP::SEND, watch.send_arm), fd, watch.send_buffer.data() + watch.send_offset,
+						   watch.send_buffer.length() - watch.send_offset))
+	{
+		return;
+	}
+
+	this->_logger->error("The io_uring submission queue is full.");
+	watch.send_in_flight = false;
+	watch.send_buffer.clear();
+	watch.send_offset = 0;
+	if (watch.session) watch.ops->on_sent(watch.session, -EAGAIN, true);
+}
+
+void RconReactor::run()
+{
+	this->_stopped = false;
+	while (!this->_stopped && this->_watch_count > 0)
+	{
+		if (this->run_once(std::chrono::milliseconds(1000)) < 0) break;
+	}
+}
+
+bool RconReactor::_add(int fd, uint32_t events, std::shared_ptr<watch_t> watch)
+{
+	if (fd < 0 || (this->_uring && fd > MAX_URING_FD)) return false;
+	if ((size_t) fd >= this->_watches.size()) this->_watches.resize(std::max((size_t) fd + 1, this->_watches.size() * 2));
+	if (this->_watches[fd])
+	{
+		this->_logger->error("File descriptor " + std::to_string(fd) + " is already being watched.");
+		return false;
+	}
+
+	watch->generation = this->_next_generation++;
+	watch->events = events;
+	watch->arm = 0;
+	watch->poll_armed = false;
+	watch->receive_armed = false;
+	watch->send_in_flight = false;
+	watch->send_arm = 0;
+	watch->send_offset = 0;
+
+	if (this->_uring)
+	{
+		this->_watches[fd] = watch;
+		this->_watch_count++;
+		this->_sync(fd, *watch);
+		return true;
+	}
+
+	struct epoll_event event;
+	event.events = events;
+	event.data.u64 = ((uint64_t) watch->generation << 32) | (uint32_t) fd;
+	if (epoll_ctl(this->_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+	{
+		this->_logger->error("LIBC \"epoll_ctl\" error (" + std::to_string(errno) + "): " + strerror(errno));
+		return false;
+	}
+
+	this->_watches[fd] = std::move(watch);
+	this->_watch_count++;
+	return true;
+}
+
+void RconReactor::_rearm(int fd, uint32_t generation)
+{
+	std::shared_ptr<watch_t> watch = this->_find(fd, generation);
+	if (!watch) return;
+
+	// The operations in flight belong to the old socket. Whatever the new one needs is submitted once the session has
+	// finished reacting to the change.
+	if (this->_uring)
+	{
+		this->_disarm(fd, *watch);
+		return;
+	}
+
+	// Replacing the socket behind a file descriptor drops it from the epoll set, so it has to be added again.
+	struct epoll_event event;
+	event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	event.data.u64 = ((uint64_t) generation << 32) | (uint32_t) fd;
+	if (epoll_ctl(this->_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0 && (errno != EEXIST || epoll_ctl(this->_epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0))
+	{
+		this->_logger->error("LIBC \"epoll_ctl\" error (" + std::to_string(errno) + "): " + strerror(errno));
+	}
+}
+
+std::shared_ptr<RconReactor::watch_t> RconReactor::_find(int fd, uint32_t generation) const
+{
+	if (fd < 0 || (size_t) fd >= this->_watches.size()) return nullptr;
+	const std::shared_ptr<watch_t> &watch = this->_watches[fd];
+	return (watch && watch->generation == generation) ? watch : nullptr;
+}
+
+void RconReactor::_schedule(int fd, watch_t &watch)
+{
+	std::chrono::steady_clock::time_point at = watch.ops->next_deadline(watch.session);
+	if (at == std::chrono::steady_clock::time_point::max()) return;
+
+	// A timer that fires before the real deadline just reschedules itself, so a new one is only needed if the deadline moved closer.
+	if (watch.timer_at != std::chrono::steady_clock::time_point::max() && watch.timer_at <= at) return;
+
+	watch.timer_at = at;
+	this->_deadlines.push({at, fd, watch.generation});
+}
+
+void RconReactor::_run_timers(std::chrono::steady_clock::time_point now)
+{
+	while (!this->_deadlines.empty() && this->_deadlines.top().at <= now)
+	{
+		deadline_t deadline = this->_deadlines.top();
+		this->_deadlines.pop();
+
+		std::shared_ptr<watch_t> watch = this->_find(deadline.fd, deadline.generation);
+		if (!watch || watch->timer_at != deadline.at) continue;
+
+		watch->timer_at = std::chrono::steady_clock::time_point::max();
+		watch->ops->on_timeout(watch->session, now);
+		if (!this->_find(deadline.fd, deadline.generation)) continue;
+		if (this->_uring) this->_sync(deadline.fd, *watch);
+		this->_schedule(deadline.fd, *watch);
+	}
+}
+
+#define CPP_RCON_DEFINE_REACTOR_SESSION(dialect) \
+	template bool RconReactor::add_session<dialect>(BasicRcon<dialect> &, RconReactor::SessionCallback<dialect>); \
+	template bool RconReactor::add_session<dialect>(BasicRcon<dialect> &, const std::string &, RconReactor::SessionCallback<dialect>); \
+	template void RconReactor::remove_session<dialect>(BasicRcon<dialect> &);
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DEFINE_REACTOR_SESSION)
+#undef CPP_RCON_DEFINE_REACTOR_SESSION
@@ -0,0 +1,182 @@
+#include "resolver.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+
+std::string resolved_addr_t::to_string() const
+{
+	char buffer[INET6_ADDRSTRLEN] = "";
+	if (this->address.ss_family == AF_INET6)
+	{
+		const struct sockaddr_in6 *ipv6 = (const struct sockaddr_in6 *) &this->address;
+		inet_ntop(AF_INET6, &ipv6->sin6_addr, buffer, sizeof(buffer));
+		return "[" + std::string(buffer) + "]:" + std::to_string(ntohs(ipv6->sin6_port));
+	}
+
+	const struct sockaddr_in *ipv4 = (const struct sockaddr_in *) &this->address;
+	inet_ntop(AF_INET, &ipv4->sin_addr, buffer, sizeof(buffer));
+	return std::string(buffer) + ":" + std::to_string(ntohs(ipv4->sin_port));
+}
+
+RconResolver::RconResolver(size_t max_threads):
+	_state(std::make_shared<shared_state_t>()),
+	_max_threads(std::max<size_t>(max_threads, 1))
+{}
+
+RconResolver::~RconResolver()
+{
+	std::lock_guard<std::mutex> lock(this->_state->mutex);
+	this->_state->stopped = true;
+	for (auto &request : this->_state->queue) request.promise.set_value({false, "The resolver was shut down.", {}});
+	this->_state->queue.clear();
+	this->_state->wake.notify_all();
+}
+
+RconResolver &RconResolver::shared()
+{
+	static RconResolver resolver;
+	return resolver;
+}
+
+std::shared_future<resolution_t> RconResolver::resolve(const std::string &host, uint16_t port)
+{
+	std::string name = host;
+	if (name.length() > 2 && name.front() == '[' && name.back() == ']') name = name.substr(1, name.length() - 2);
+
+	// Numeric addresses are parsed without any I/O, so they skip both the pool and the cache.
+	resolution_t numeric = _lookup(name, port, AI_NUMERICHOST);
+	if (numeric.success)
+	{
+		std::promise<resolution_t> ready;
+		ready.set_value(std::move(numeric));
+		return ready.get_future().share();
+	}
+
+	std::string key = name + "|" + std::to_string(port);
+	auto now = std::chrono::steady_clock::now();
+	shared_state_t &state = *this->_state;
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	auto found = state.cache.find(key);
+	if (found != state.cache.end() && now < found->second.expires) return found->second.result;
+
+	// Sweep out expired entries every now and then, so that the cache doesn't keep every host it has ever seen.
+	if (state.cache.size() >= 1024)
+	{
+		for (auto entry = state.cache.begin(); entry != state.cache.end();)
+		{
+			if (now >= entry->second.expires) entry = state.cache.erase(entry);
+			else ++entry;
+		}
+	}
+
+	request_t request{key, name, port, state.next_serial++, {}};
+	std::shared_future<resolution_t> result = request.promise.get_future().share();
+	state.cache[key] = {result, std::chrono::steady_clock::time_point::max(), request.serial};
+	state.queue.push_back(std::move(request));
+
+	if (state.idle < state.queue.size() && state.threads < this->_max_threads)
+	{
+		state.threads++;
+		std::thread(_work, this->_state).detach();
+	}
+	else
+	{
+		state.wake.notify_one();
+	}
+	return result;
+}
+
+void RconResolver::set_ttl(std::chrono::seconds ttl, std::chrono::seconds negative_ttl)
+{
+	std::lock_guard<std::mutex> lock(this->_state->mutex);
+	this->_state->ttl = ttl;
+	this->_state->negative_ttl = negative_ttl;
+}
+
+void RconResolver::clear()
+{
+	std::lock_guard<std::mutex> lock(this->_state->mutex);
+	this->_state->cache.clear();
+}
+
+void RconResolver::_work(std::shared_ptr<shared_state_t> state)
+{
+	std::unique_lock<std::mutex> lock(state->mutex);
+	while (true)
+	{
+		state->idle++;
+		state->wake.wait(lock, [&] { return state->stopped || !state->queue.empty(); });
+		state->idle--;
+		if (state->stopped) break;
+
+		request_t request = std::move(state->queue.front());
+		state->queue.pop_front();
+
+		lock.unlock();
+		resolution_t result = _lookup(request.host, request.port, 0);
+		lock.lock();
+
+		// The cache may have been cleared while the lookup was running, in which case the result is only handed to its waiters.
+		auto entry = state->cache.find(request.key);
+		if (entry != state->cache.end() && entry->second.serial == request.serial)
+		{
+			entry->second.expires = std::chrono::steady_clock::now() + (result.success ? state->ttl : state->negative_ttl);
+		}
+		request.promise.set_value(std::move(result));
+	}
+	state->threads--;
+}
+
+resolution_t RconResolver::_lookup(const std::string &host, uint16_t port, int flags)
+{
+	resolution_t result{false, "", {}};
+
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = flags | AI_NUMERICSERV;
+
+	struct addrinfo *list = nullptr;
+	std::string service = std::to_string(port);
+	int status = getaddrinfo(host.c_str(), service.c_str(), &hints, &list);
+	if (status != 0)
+	{
+		result.error = status == EAI_SYSTEM ? strerror(errno) : gai_strerror(status);
+		return result;
+	}
+
+	// Keep the system's order within each family, but alternate between the families, so that an unreachable family
+	// only ever costs a single attempt delay.
+	std::vector<resolved_addr_t> by_family[2];
+	int first_family = list->ai_family;
+	for (struct addrinfo *info = list; info; info = info->ai_next)
+	{
+		if (info->ai_family != AF_INET && info->ai_family != AF_INET6) continue;
+
+		resolved_addr_t address;
+		memset(&address.address, 0, sizeof(address.address));
+		memcpy(&address.address, info->ai_addr, info->ai_addrlen);
+		address.length = info->ai_addrlen;
+		by_family[info->ai_family == first_family ? 0 : 1].push_back(address);
+	}
+	freeaddrinfo(list);
+
+	for (size_t i = 0; i < std::max(by_family[0].size(), by_family[1].size()); i++)
+	{
+		if (i < by_family[0].size()) result.addresses.push_back(by_family[0][i]);
+		if (i < by_family[1].size()) result.addresses.push_back(by_family[1][i]);
+	}
+
+	result.success = !result.addresses.empty();
+	if (!result.success) result.error = "No IPv4 or IPv6 addresses found.";
+	return result;
+}
@@ -0,0 +1,212 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+RconScheduler::RconScheduler(RconReactor &reactor, std::chrono::milliseconds resolution):
+	_logger(new Logger("RCON SCHEDULER", LOG_LEVEL::WARNING)),
+	_reactor(reactor),
+	_resolution(std::max(resolution, std::chrono::milliseconds(1))),
+	_epoch(std::chrono::steady_clock::now())
+{
+	this->_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (this->_timer_fd < 0)
+	{
+		this->_logger->fatal("LIBC \"timerfd_create\" error (" + std::to_string(errno) + "): " + strerror(errno));
+		return;
+	}
+	this->_reactor.watch(this->_timer_fd, EPOLLIN, [this](uint32_t) {
+		uint64_t expirations;
+		while (::read(this->_timer_fd, &expirations, sizeof(expirations)) > 0) {}
+		this->_armed_tick = 0;
+		this->_advance(std::chrono::steady_clock::now());
+		this->_arm();
+	});
+}
+
+RconScheduler::~RconScheduler()
+{
+	if (this->_timer_fd < 0) return;
+	this->_reactor.unwatch(this->_timer_fd);
+	::close(this->_timer_fd);
+}
+
+template <typename Dialect>
+uint64_t RconScheduler::add_job(BasicRcon<Dialect> &session, std::vector<std::string> commands, std::chrono::milliseconds interval,
+								std::chrono::milliseconds jitter, JobCallback callback)
+{
+	auto job = std::make_shared<job_t>();
+	job->session = &session;
+	job->send_batch = _send_batch<Dialect>;
+	job->commands = std::move(commands);
+	job->interval = interval;
+	job->jitter = std::max(jitter, std::chrono::milliseconds(0));
+	job->callback = std::move(callback);
+	return this->_add_job(std::move(job));
+}
+
+template <typename Dialect>
+void RconScheduler::_send_batch(void *session, const std::vector<std::string_view> &commands, BatchCallback callback)
+{
+	((BasicRcon<Dialect> *) session)->send_batch_async(commands, std::move(callback));
+}
+
+uint64_t RconScheduler::_add_job(std::shared_ptr<job_t> job)
+{
+	if (job->interval <= std::chrono::steady_clock::duration::zero())
+	{
+		this->_logger->error("The interval of a job must be positive.");
+		return 0;
+	}
+	if (this->_timer_fd < 0) return 0;
+
+	job->id = this->_next_job++;
+	job->base = std::chrono::steady_clock::now();
+	job->pending = false;
+	job->skipped = 0;
+	this->_jobs.emplace(job->id, job);
+	this->_schedule(job);
+	this->_arm();
+	return job->id;
+}
+
+bool RconScheduler::remove_job(uint64_t job)
+{
+	// The job's slot in the wheel only holds a weak reference, which is skipped once it has expired.
+	if (!this->_jobs.erase(job)) return false;
+	if (this->_jobs.empty()) this->_arm();
+	return true;
+}
+
+uint64_t RconScheduler::_tick_at(std::chrono::steady_clock::time_point time) const
+{
+	if (time <= this->_epoch) return 0;
+	return (uint64_t) ((time - this->_epoch + this->_resolution - std::chrono::steady_clock::duration(1)) / this->_resolution);
+}
+
+void RconScheduler::_schedule(const std::shared_ptr<job_t> &job)
+{
+	auto now = std::chrono::steady_clock::now();
+	job->base += job->interval;
+	// After a stall, runs that were missed entirely aren't made up for.
+	if (job->base <= now) job->base = now + job->interval;
+
+	auto due = job->base;
+	if (job->jitter.count() > 0)
+	{
+		std::uniform_int_distribution<int64_t> jitter(0, job->jitter.count());
+		due += std::chrono::steady_clock::duration(jitter(this->_jitter_rng));
+	}
+	this->_wheel.insert(job, this->_tick_at(due));
+}
+
+void RconScheduler::_advance(std::chrono::steady_clock::time_point now)
+{
+	if (now < this->_epoch) return;
+	uint64_t target = (uint64_t) ((now - this->_epoch) / this->_resolution);
+
+	std::vector<std::shared_ptr<job_t>> due;
+	this->_wheel.advance(target, [&due](std::shared_ptr<job_t> job) { due.push_back(std::move(job)); });
+	if (!due.empty()) this->_fire(due);
+}
+
+void RconScheduler::_fire(std::vector<std::shared_ptr<job_t>> &due)
+{
+	using scheduler_clock = std::chrono::steady_clock;
+
+	typedef struct
+	{
+		std::weak_ptr<job_t> job;
+		/// Where the job's commands start in the batch.
+		size_t offset;
+	} batch_entry_t;
+
+	std::vector<std::shared_ptr<job_t>> runs;
+	runs.reserve(due.size());
+	for (auto &job : due)
+	{
+		this->_schedule(job);
+		if (job->pending)
+		{
+			job->skipped++;
+			continue;
+		}
+		runs.push_back(job);
+	}
+
+	// Jobs on the same session end up next to each other, in the order they were added.
+	std::sort(runs.begin(), runs.end(), [](const std::shared_ptr<job_t> &a, const std::shared_ptr<job_t> &b) {
+		return a->session != b->session ? std::less<void *>()(a->session, b->session) : a->id < b->id;
+	});
+
+	std::vector<std::string_view> commands;
+	for (size_t first = 0; first < runs.size();)
+	{
+		size_t last = first;
+		while (last < runs.size() && runs[last]->session == runs[first]->session) last++;
+
+		commands.clear();
+		std::vector<batch_entry_t> entries;
+		entries.reserve(last - first);
+		for (size_t i = first; i < last; i++)
+		{
+			entries.push_back(batch_entry_t{runs[i], commands.size()});
+			commands.insert(commands.end(), runs[i]->commands.begin(), runs[i]->commands.end());
+			runs[i]->pending = true;
+		}
+
+		scheduler_clock::time_point sent_at = scheduler_clock::now();
+		runs[first]->send_batch(runs[first]->session, commands, [entries = std::move(entries), sent_at](bool success, std::vector<std::string> responses) {
+			auto latency = std::chrono::duration_cast<std::chrono::microseconds>(scheduler_clock::now() - sent_at);
+			for (const batch_entry_t &entry : entries)
+			{
+				std::shared_ptr<job_t> job = entry.job.lock();
+				// Removed jobs don't report anymore.
+				if (!job) continue;
+
+				scheduled_result_t result;
+				result.job = job->id;
+				result.success = success;
+				result.latency = latency;
+				result.skipped = job->skipped;
+				for (size_t i = 0; i < job->commands.size() && entry.offset + i < responses.size(); i++)
+				{
+					result.responses.push_back(std::move(responses[entry.offset + i]));
+				}
+				job->pending = false;
+				job->skipped = 0;
+				if (job->callback) job->callback(result);
+			}
+		});
+		first = last;
+	}
+}
+
+void RconScheduler::_arm()
+{
+	uint64_t next = this->_jobs.empty() ? 0 : this->_wheel.next_tick();
+	if (next == this->_armed_tick) return;
+	this->_armed_tick = next;
+
+	struct itimerspec timer;
+	memset(&timer, 0, sizeof(timer));
+	if (next != 0)
+	{
+		auto at = std::chrono::duration_cast<std::chrono::nanoseconds>((this->_epoch + next * this->_resolution).time_since_epoch());
+		timer.it_value.tv_sec = at.count() / 1000000000;
+		timer.it_value.tv_nsec = at.count() % 1000000000;
+	}
+	if (timerfd_settime(this->_timer_fd, TFD_TIMER_ABSTIME, &timer, nullptr) < 0)
+	{
+		this->_logger->error("LIBC \"timerfd_settime\" error (" + std::to_string(errno) + "): " + strerror(errno));
+	}
+}
+
+#define CPP_RCON_DEFINE_SCHEDULER(dialect) \
+	template uint64_t RconScheduler::add_job<dialect>(BasicRcon<dialect> &, std::vector<std::string>, std::chrono::milliseconds, \
+													  std::chrono::milliseconds, RconScheduler::JobCallback);
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DEFINE_SCHEDULER)
+#undef CPP_RCON_DEFINE_SCHEDULER
@@ -0,0 +1,186 @@
+#include "script.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <memory>
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+template <typename Dialect>
+size_t run_script(BasicRcon<Dialect> &session, std::istream &input, int input_fd, size_t window, const std::function<void(const script_result_t &)> &on_result)
+{
+	using script_clock = std::chrono::steady_clock;
+
+	typedef struct
+	{
+		script_result_t result;
+		script_clock::time_point sent_at;
+		bool done;
+	} script_slot_t;
+
+	window = std::max<size_t>(window, 1);
+	std::deque<std::shared_ptr<script_slot_t>> slots;
+	size_t in_flight = 0;
+	size_t failures = 0;
+	uint64_t next_index = 0;
+	bool end_of_input = false;
+
+	// Input read from input_fd that hasn't been split into lines yet, starting at input_offset.
+	std::string buffered;
+	size_t input_offset = 0;
+	bool end_of_stream = false;
+	std::string chunk(64 * 1024, '\0');
+
+	auto input_ready = [&] {
+		if (input.rdbuf()->in_avail() > 0) return true;
+		struct pollfd poll_fd;
+		poll_fd.fd = input_fd;
+		poll_fd.events = POLLIN;
+		poll_fd.revents = 0;
+		// Errors and hangups count as ready too, so that the read notices them.
+		return ::poll(&poll_fd, 1, 0) != 0;
+	};
+
+	// Takes the next line of input. Unless `block` is set, only reads as much as is available without blocking, since
+	// std::getline would wait for the rest of a line that hasn't been finished yet.
+	auto next_line = [&](std::string &line, bool block) {
+		if (input_fd < 0)
+		{
+			if (std::getline(input, line)) return true;
+			end_of_input = true;
+			return false;
+		}
+
+		while (true)
+		{
+			size_t newline = buffered.find('\n', input_offset);
+			if (newline != std::string::npos)
+			{
+				line.assign(buffered, input_offset, newline - input_offset);
+				input_offset = newline + 1;
+				return true;
+			}
+			if (end_of_stream)
+			{
+				end_of_input = input_offset == buffered.length();
+				if (end_of_input) return false;
+				// The last line doesn't have to end with a newline.
+				line.assign(buffered, input_offset);
+				input_offset = buffered.length();
+				return true;
+			}
+			if (!block && !input_ready()) return false;
+
+			buffered.erase(0, input_offset);
+			input_offset = 0;
+			// Whatever the stream has buffered already comes before anything that is still in the descriptor.
+			std::streamsize available = input.rdbuf()->in_avail();
+			ssize_t received = available > 0 ? input.rdbuf()->sgetn(chunk.data(), std::min<std::streamsize>(available, chunk.size()))
+											 : ::read(input_fd, chunk.data(), chunk.size());
+			if (received < 0 && errno == EINTR) continue;
+			if (received <= 0) end_of_stream = true;
+			else buffered.append(chunk.data(), received);
+		}
+	};
+
+	while (true)
+	{
+		// Only block on the input once every response has been reported. Otherwise they would sit unreported behind a slow producer.
+		std::string line;
+		while (!end_of_input && in_flight < window && next_line(line, slots.empty()))
+		{
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (line.empty()) continue;
+
+			auto slot = std::make_shared<script_slot_t>();
+			slot->result = {next_index++, line, false, "", std::chrono::microseconds(0)};
+			slot->sent_at = script_clock::now();
+			slot->done = false;
+			slots.push_back(slot);
+			in_flight++;
+
+			session.send_command_async(line, [slot, &in_flight](bool success, std::string response) {
+				slot->result.success = success;
+				slot->result.response = std::move(response);
+				slot->result.latency = std::chrono::duration_cast<std::chrono::microseconds>(script_clock::now() - slot->sent_at);
+				slot->done = true;
+				in_flight--;
+			});
+		}
+
+		// The session completes commands in order, but report them strictly in order regardless.
+		while (!slots.empty() && slots.front()->done)
+		{
+			if (!slots.front()->result.success) failures++;
+			on_result(slots.front()->result);
+			slots.pop_front();
+		}
+
+		if (end_of_input && slots.empty()) break;
+		// With room in the window, come back for more input soon.
+		if (in_flight > 0) session.poll(in_flight >= window || end_of_input ? std::chrono::milliseconds(1000) : std::chrono::milliseconds(5));
+	}
+	return failures;
+}
+
+#define CPP_RCON_DEFINE_SCRIPT(dialect) \
+	template size_t run_script<dialect>(BasicRcon<dialect> &, std::istream &, int, size_t, const std::function<void(const script_result_t &)> &);
+CPP_RCON_FOR_EACH_DIALECT(CPP_RCON_DEFINE_SCRIPT)
+#undef CPP_RCON_DEFINE_SCRIPT
+
+namespace
+{
+	void append_json_string(std::string &out, const std::string &value)
+	{
+		static const char hex_digits[] = "0123456789abcdef";
+		out += '"';
+		for (unsigned char ch : value)
+		{
+			switch (ch)
+			{
+				case '"': out += "\\\""; break;
+				case '\\': out += "\\\\"; break;
+				case '\n': out += "\\n"; break;
+				case '\r': out += "\\r"; break;
+				case '\t': out += "\\t"; break;
+				default:
+					if (ch < 0x20)
+					{
+						out += "\\u00";
+						out += hex_digits[ch >> 4];
+						out += hex_digits[ch & 0xF];
+					}
+					else
+					{
+						out += (char) ch;
+					}
+			}
+		}
+		out += '"';
+	}
+}
+
+void format_script_result(std::string &out, const script_result_t &result, SCRIPT_FORMAT format)
+{
+	if (format == SCRIPT_FORMAT::LENGTH_PREFIXED)
+	{
+		out += std::to_string(result.index) + " " + (result.success ? "1" : "0") + " " + std::to_string(result.latency.count()) + " " +
+			std::to_string(result.command.length()) + " " + std::to_string(result.response.length()) + "\n";
+		out += result.command;
+		out += result.response;
+		out += '\n';
+		return;
+	}
+
+	char latency[32];
+	snprintf(latency, sizeof(latency), "%.3f", result.latency.count() / 1000.0);
+
+	out += "{\"index\":" + std::to_string(result.index) + ",\"command\":";
+	append_json_string(out, result.command);
+	out += std::string(",\"success\":") + (result.success ? "true" : "false") + ",\"latency_ms\":" + latency + ",\"response\":";
+	append_json_string(out, result.response);
+	out += "}\n";
+}
@@ -0,0 +1,350 @@
+#include "server.hpp"
+
+#include <cstring>
+#include <errno.h>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+RconServer::RconServer(RconReactor &reactor, std::string password):
+	_reactor(reactor),
+	_logger(new Logger("RCON SERVER", LOG_LEVEL::WARNING)),
+	_password(std::move(password))
+{
+}
+
+bool RconServer::listen(uint16_t port, const std::string &ip)
+{
+	if (this->_listen_socket >= 0)
+	{
+		this->_logger->error("Server is already listening on port " + std::to_string(this->_port) + ".");
+		return false;
+	}
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	if (inet_pton(AF_INET, ip.c_str(), &address.sin_addr) != 1)
+	{
+		this->_logger->error("Invalid IPv4 address \"" + ip + "\".");
+		return false;
+	}
+
+	this->_listen_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (this->_listen_socket < 0)
+	{
+		this->_logger->error("LIBC \"socket\" error (" + std::to_string(errno) + "): " + strerror(errno));
+		return false;
+	}
+
+	int reuse = 1;
+	setsockopt(this->_listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	socklen_t length = sizeof(address);
+	if (bind(this->_listen_socket, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+		::listen(this->_listen_socket, SOMAXCONN) != 0 ||
+		getsockname(this->_listen_socket, (struct sockaddr *) &address, &length) != 0)
+	{
+		this->_logger->error("Failed to listen on " + ip + ":" + std::to_string(port) + " (" + std::to_string(errno) + "): " + strerror(errno));
+		::close(this->_listen_socket);
+		this->_listen_socket = -1;
+		return false;
+	}
+
+	if (!this->_reactor.watch(this->_listen_socket, EPOLLIN, [this](uint32_t) { this->_accept(); }))
+	{
+		::close(this->_listen_socket);
+		this->_listen_socket = -1;
+		return false;
+	}
+
+	this->_port = ntohs(address.sin_port);
+	this->_logger->info("Listening on " + ip + ":" + std::to_string(this->_port));
+	return true;
+}
+
+void RconServer::close()
+{
+	for (auto &entry : this->_clients)
+	{
+		this->_reactor.unwatch(entry.second->socket);
+		::close(entry.second->socket);
+	}
+	this->_clients.clear();
+
+	if (this->_listen_socket >= 0)
+	{
+		this->_reactor.unwatch(this->_listen_socket);
+		::close(this->_listen_socket);
+		this->_listen_socket = -1;
+		this->_port = 0;
+	}
+}
+
+void RconServer::_accept()
+{
+	while (true)
+	{
+		struct sockaddr_in address;
+		socklen_t length = sizeof(address);
+		int client_socket = accept4(this->_listen_socket, (struct sockaddr *) &address, &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (client_socket < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				this->_logger->error("LIBC \"accept4\" error (" + std::to_string(errno) + "): " + strerror(errno));
+			return;
+		}
+
+		// Responses are written as soon as they are ready, so don't let Nagle's algorithm hold them back.
+		int no_delay = 1;
+		setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+		uint64_t id = this->_next_client++;
+		auto client = std::make_unique<client_t>();
+		client->socket = client_socket;
+		client->address = rcon_addr_t{inet_ntoa(address.sin_addr), ntohs(address.sin_port)}.to_string();
+		client->authenticated = false;
+		client->out_offset = 0;
+		client->first_sequence = 0;
+		client->paused = false;
+
+		if (!this->_reactor.watch(client_socket, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, [this, id](uint32_t events) { this->_handle_client(id, events); }))
+		{
+			::close(client_socket);
+			continue;
+		}
+
+		this->_logger->debug([&] { return "Accepted a connection from " + client->address; });
+		this->_clients.emplace(id, std::move(client));
+	}
+}
+
+void RconServer::_handle_client(uint64_t id, uint32_t events)
+{
+	auto entry = this->_clients.find(id);
+	if (entry == this->_clients.end()) return;
+	client_t &client = *entry->second;
+
+	// A paused client is read from again by _pump once it has caught up. Until then, its requests wait in the kernel.
+	if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) && !client.paused && !this->_receive(id, client)) return;
+	this->_pump(id, client);
+}
+
+bool RconServer::_receive(uint64_t id, client_t &client)
+{
+	// Responses given while reading are written out together afterwards. A handler may resume another client, so this nests.
+	uint64_t reading = std::exchange(this->_reading, id);
+
+	// The socket is edge triggered, so it has to be drained completely unless the client gets paused.
+	while (true)
+	{
+		rcon_packet_t packet;
+		while (!this->_over_limit(client, 1) && client.framer.next(packet))
+		{
+			if (!this->_handle_packet(id, client, packet))
+			{
+				this->_reading = reading;
+				return false;
+			}
+		}
+
+		if (client.framer.is_corrupt())
+		{
+			this->_logger->warn("Received a malformed packet from " + client.address + ". Disconnecting...");
+			this->_reading = reading;
+			this->_disconnect(id);
+			return false;
+		}
+
+		if (this->_over_limit(client, 1))
+		{
+			this->_logger->debug([&] { return "Paused reading from " + client.address + " until it has caught up."; });
+			client.paused = true;
+			break;
+		}
+
+		size_t available;
+		char *buffer = client.framer.prepare(available);
+		ssize_t received = recv(client.socket, buffer, available, 0);
+		if (received < 0 && errno == EINTR) continue;
+		if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		if (received <= 0)
+		{
+			if (received < 0) this->_logger->error("LIBC \"recv\" error (" + std::to_string(errno) + "): " + strerror(errno));
+			this->_reading = reading;
+			this->_disconnect(id);
+			return false;
+		}
+		client.framer.commit(received);
+	}
+
+	this->_reading = reading;
+	return true;
+}
+
+bool RconServer::_over_limit(const client_t &client, size_t divisor) const
+{
+	return client.slots.size() >= this->_max_pending_commands / divisor ||
+		   client.out_buffer.length() - client.out_offset >= this->_max_pending_bytes / divisor;
+}
+
+bool RconServer::_pump(uint64_t id, client_t &client)
+{
+	while (true)
+	{
+		if (!this->_flush(id, client)) return false;
+		if (!client.paused || this->_over_limit(client, 2)) return true;
+
+		this->_logger->debug([&] { return "Resumed reading from " + client.address; });
+		client.paused = false;
+		if (!this->_receive(id, client)) return false;
+	}
+}
+
+bool RconServer::_handle_packet(uint64_t id, client_t &client, const rcon_packet_t &packet)
+{
+	if (packet.type == (int32_t) Rcon::PACKET_TYPE::SERVERDATA_AUTH)
+	{
+		client.authenticated = packet.body == this->_password;
+
+		uint64_t sequence = this->_reserve(client, packet.id);
+		std::string &output = this->_slot_buffer(client, sequence);
+		append_packet(output, packet.id, (int32_t) Rcon::PACKET_TYPE::SERVERDATA_RESPONSE_VALUE, "");
+		append_packet(output, client.authenticated ? packet.id : -1, (int32_t) Rcon::PACKET_TYPE::SERVERDATA_AUTH_RESPONSE, "");
+		this->_release(client, sequence);
+		if (client.authenticated) return true;
+
+		// Otherwise a single connection could keep guessing passwords. The rejection is sent on a best-effort basis.
+		this->_logger->warn("Failed authentication attempt from " + client.address + ". Disconnecting...");
+		if (this->_flush(id, client)) this->_disconnect(id);
+		return false;
+	}
+
+	if (!client.authenticated)
+	{
+		this->_logger->warn("Received a request from unauthenticated client " + client.address + ". Disconnecting...");
+		this->_disconnect(id);
+		return false;
+	}
+
+	if (packet.type == (int32_t) Rcon::PACKET_TYPE::SERVERDATA_EXECCOMMAND)
+	{
+		uint64_t sequence = this->_reserve(client, packet.id);
+		if (!this->_handler)
+		{
+			this->_respond(id, sequence, "");
+			return true;
+		}
+
+		this->_handler(packet.body, Responder(this, id, sequence));
+		// The handler may have closed the server.
+		return this->_clients.count(id) > 0;
+	}
+
+	if (packet.type == (int32_t) Rcon::PACKET_TYPE::SERVERDATA_RESPONSE_VALUE)
+	{
+		// Clients send an empty response packet after a command to find the end of its response, so echo it back once
+		// every response before it has been sent.
+		uint64_t sequence = this->_reserve(client, packet.id);
+		append_packet(this->_slot_buffer(client, sequence), packet.id, (int32_t) Rcon::PACKET_TYPE::SERVERDATA_RESPONSE_VALUE, "");
+		this->_release(client, sequence);
+		return true;
+	}
+
+	this->_logger->debug([&] { return "Ignored a packet of unknown type " + std::to_string(packet.type) + " from " + client.address; });
+	return true;
+}
+
+uint64_t RconServer::_reserve(client_t &client, int32_t packet_id)
+{
+	client.slots.push_back({packet_id, false, std::string()});
+	return client.first_sequence + client.slots.size() - 1;
+}
+
+std::string &RconServer::_slot_buffer(client_t &client, uint64_t sequence)
+{
+	if (sequence == client.first_sequence) return client.out_buffer;
+	return client.slots[sequence - client.first_sequence].packets;
+}
+
+void RconServer::_release(client_t &client, uint64_t sequence)
+{
+	client.slots[sequence - client.first_sequence].ready = true;
+	while (!client.slots.empty() && client.slots.front().ready)
+	{
+		client.out_buffer.append(client.slots.front().packets);
+		client.slots.pop_front();
+		client.first_sequence++;
+	}
+}
+
+void RconServer::_respond(uint64_t id, uint64_t sequence, std::string_view response)
+{
+	auto entry = this->_clients.find(id);
+	if (entry == this->_clients.end()) return;
+	client_t &client = *entry->second;
+
+	if (sequence < client.first_sequence || sequence - client.first_sequence >= client.slots.size() ||
+		client.slots[sequence - client.first_sequence].ready)
+	{
+		this->_logger->error("A command from " + client.address + " was responded to more than once.");
+		return;
+	}
+
+	this->_encode_response(this->_slot_buffer(client, sequence), client.slots[sequence - client.first_sequence].packet_id, response);
+	this->_release(client, sequence);
+	if (this->_reading != id) this->_pump(id, client);
+}
+
+void RconServer::_encode_response(std::string &output, int32_t packet_id, std::string_view response)
+{
+	// An empty response is still sent as a single empty packet.
+	do {
+		std::string_view chunk = response.substr(0, MAX_BODY_LENGTH);
+		append_packet(output, packet_id, (int32_t) Rcon::PACKET_TYPE::SERVERDATA_RESPONSE_VALUE, chunk);
+		response.remove_prefix(chunk.size());
+	} while (!response.empty());
+}
+
+bool RconServer::_flush(uint64_t id, client_t &client)
+{
+	while (client.out_offset < client.out_buffer.length())
+	{
+		ssize_t bytes_sent = ::send(
+			client.socket,
+			client.out_buffer.data() + client.out_offset,
+			client.out_buffer.length() - client.out_offset,
+			MSG_NOSIGNAL
+		);
+		if (bytes_sent < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+			if (errno == EINTR) continue;
+			this->_logger->error("LIBC \"send\" error (" + std::to_string(errno) + "): " + strerror(errno));
+			this->_disconnect(id);
+			return false;
+		}
+		client.out_offset += bytes_sent;
+	}
+
+	client.out_buffer.clear();
+	client.out_offset = 0;
+	return true;
+}
+
+void RconServer::_disconnect(uint64_t id)
+{
+	auto entry = this->_clients.find(id);
+	if (entry == this->_clients.end()) return;
+
+	this->_logger->debug([&] { return "Closed the connection to " + entry->second->address; });
+	this->_reactor.unwatch(entry->second->socket);
+	::close(entry->second->socket);
+	this->_clients.erase(entry);
+}
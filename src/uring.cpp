@@ -0,0 +1,289 @@
+#include "uring.hpp"
+
+#ifdef CPP_RCON_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <endian.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+IoUring::IoUring(unsigned entries, unsigned buffer_count, size_t buffer_size)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+	params.cq_entries = entries * 4;
+
+	this->_ring_fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+	if (this->_ring_fd < 0 && errno == EINVAL)
+	{
+		// Kernels before 5.19 don't know the last two flags, but they are only optimisations.
+		params.flags = IORING_SETUP_CQSIZE;
+		this->_ring_fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+	}
+	if (this->_ring_fd < 0)
+	{
+		this->_error = std::string("io_uring_setup failed: ") + strerror(errno);
+		return;
+	}
+
+	const uint32_t required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+	if ((params.features & required) != required)
+	{
+		this->_error = "The kernel's io_uring is too old.";
+		::close(this->_ring_fd);
+		this->_ring_fd = -1;
+		return;
+	}
+
+	// With IORING_FEAT_SINGLE_MMAP, the submission and completion rings share one mapping.
+	this->_ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+								params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+	this->_ring_memory = mmap(nullptr, this->_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->_ring_fd, IORING_OFF_SQ_RING);
+	this->_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	void *sqes = mmap(nullptr, this->_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->_ring_fd, IORING_OFF_SQES);
+	if (this->_ring_memory == MAP_FAILED || sqes == MAP_FAILED)
+	{
+		this->_error = std::string("Failed to map the io_uring queues: ") + strerror(errno);
+		if (this->_ring_memory == MAP_FAILED) this->_ring_memory = nullptr;
+		if (sqes != MAP_FAILED) munmap(sqes, this->_sqes_size);
+		this->_release();
+		return;
+	}
+	this->_sqes = (struct io_uring_sqe *) sqes;
+
+	char *ring = (char *) this->_ring_memory;
+	this->_sq_head = (unsigned *) (ring + params.sq_off.head);
+	this->_sq_tail = (unsigned *) (ring + params.sq_off.tail);
+	this->_sq_mask = *(unsigned *) (ring + params.sq_off.ring_mask);
+	this->_sq_entries = params.sq_entries;
+	this->_cq_head = (unsigned *) (ring + params.cq_off.head);
+	this->_cq_tail = (unsigned *) (ring + params.cq_off.tail);
+	this->_cq_mask = *(unsigned *) (ring + params.cq_off.ring_mask);
+	this->_cqes = (struct io_uring_cqe *) (ring + params.cq_off.cqes);
+
+	// Submission queue entries are always used in order, so the indirection array never changes.
+	unsigned *array = (unsigned *) (ring + params.sq_off.array);
+	for (unsigned i = 0; i < params.sq_entries; i++) array[i] = i;
+
+	unsigned count = 1;
+	while (count < buffer_count && count < 32768) count <<= 1;
+	this->_buffer_count = count;
+	this->_buffer_size = buffer_size;
+	this->_buffer_ring_size = count * sizeof(struct io_uring_buf);
+	this->_buffer_ring = mmap(nullptr, this->_buffer_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	void *buffers = mmap(nullptr, count * buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (this->_buffer_ring == MAP_FAILED || buffers == MAP_FAILED)
+	{
+		this->_error = std::string("Failed to allocate the receive buffers: ") + strerror(errno);
+		if (this->_buffer_ring == MAP_FAILED) this->_buffer_ring = nullptr;
+		if (buffers != MAP_FAILED) munmap(buffers, count * buffer_size);
+		this->_release();
+		return;
+	}
+	this->_buffers = (char *) buffers;
+
+	struct io_uring_buf_reg registration;
+	memset(&registration, 0, sizeof(registration));
+	registration.ring_addr = (uint64_t) (uintptr_t) this->_buffer_ring;
+	registration.ring_entries = count;
+	registration.bgid = 0;
+	if (syscall(__NR_io_uring_register, this->_ring_fd, IORING_REGISTER_PBUF_RING, &registration, 1) != 0)
+	{
+		this->_error = std::string("Failed to register the receive buffers (needs Linux 5.19): ") + strerror(errno);
+		this->_release();
+		return;
+	}
+	this->_buffers_registered = true;
+	for (unsigned id = 0; id < count; id++) this->recycle((uint16_t) id);
+}
+
+IoUring::~IoUring()
+{
+	this->_release();
+}
+
+void IoUring::_release()
+{
+	// Take the buffers away from the kernel first, so that nothing is received into them once they are unmapped.
+	if (this->_buffers_registered)
+	{
+		struct io_uring_buf_reg registration;
+		memset(&registration, 0, sizeof(registration));
+		registration.bgid = 0;
+		syscall(__NR_io_uring_register, this->_ring_fd, IORING_UNREGISTER_PBUF_RING, &registration, 1);
+		this->_buffers_registered = false;
+	}
+	if (this->_ring_fd >= 0) ::close(this->_ring_fd);
+	this->_ring_fd = -1;
+	if (this->_ring_memory) munmap(this->_ring_memory, this->_ring_size);
+	if (this->_sqes) munmap(this->_sqes, this->_sqes_size);
+	if (this->_buffer_ring) munmap(this->_buffer_ring, this->_buffer_ring_size);
+	if (this->_buffers) munmap(this->_buffers, this->_buffer_count * this->_buffer_size);
+	this->_ring_memory = nullptr;
+	this->_sqes = nullptr;
+	this->_buffer_ring = nullptr;
+	this->_buffers = nullptr;
+}
+
+struct io_uring_sqe *IoUring::_next_sqe()
+{
+	unsigned tail = *this->_sq_tail;
+	if (tail - __atomic_load_n(this->_sq_head, __ATOMIC_ACQUIRE) >= this->_sq_entries)
+	{
+		this->submit();
+		if (tail - __atomic_load_n(this->_sq_head, __ATOMIC_ACQUIRE) >= this->_sq_entries) return nullptr;
+	}
+
+	struct io_uring_sqe *sqe = &this->_sqes[tail & this->_sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	__atomic_store_n(this->_sq_tail, tail + 1, __ATOMIC_RELEASE);
+	this->_unsubmitted++;
+	return sqe;
+}
+
+int IoUring::_enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, size_t arg_size)
+{
+	long result = syscall(__NR_io_uring_enter, this->_ring_fd, to_submit, min_complete, flags, arg, arg_size);
+	return result < 0 ? -errno : (int) result;
+}
+
+bool IoUring::poll(uint64_t user_data, int fd, uint32_t events, bool multishot)
+{
+	struct io_uring_sqe *sqe = this->_next_sqe();
+	if (!sqe) return false;
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+#if __BYTE_ORDER == __BIG_ENDIAN
+	events = (events << 16) | (events >> 16);
+#endif
+	sqe->poll32_events = events;
+	sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+	sqe->user_data = user_data;
+	return true;
+}
+
+bool IoUring::receive(uint64_t user_data, int fd, bool multishot)
+{
+	struct io_uring_sqe *sqe = this->_next_sqe();
+	if (!sqe) return false;
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = fd;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = 0;
+	// A multishot receive takes the length from each buffer it picks.
+	sqe->len = multishot ? 0 : this->_buffer_size;
+	sqe->ioprio = multishot ? IORING_RECV_MULTISHOT : 0;
+	sqe->user_data = user_data;
+	return true;
+}
+
+bool IoUring::send(uint64_t user_data, int fd, const char *data, size_t length)
+{
+	struct io_uring_sqe *sqe = this->_next_sqe();
+	if (!sqe) return false;
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t) (uintptr_t) data;
+	sqe->len = length;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = user_data;
+	return true;
+}
+
+bool IoUring::cancel(uint64_t user_data, uint64_t target)
+{
+	struct io_uring_sqe *sqe = this->_next_sqe();
+	if (!sqe) return false;
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = target;
+	sqe->user_data = user_data;
+	return true;
+}
+
+int IoUring::submit()
+{
+	if (this->_unsubmitted == 0) return 0;
+	int result = this->_enter(this->_unsubmitted, 0, 0, nullptr, 0);
+	if (result > 0) this->_unsubmitted -= std::min<unsigned>(result, this->_unsubmitted);
+	return result;
+}
+
+int IoUring::submit_and_wait(std::chrono::milliseconds timeout)
+{
+	// Completions that are already waiting make sleeping pointless.
+	if (__atomic_load_n(this->_cq_tail, __ATOMIC_ACQUIRE) != *this->_cq_head) return this->submit();
+
+	struct __kernel_timespec timespec;
+	timespec.tv_sec = timeout.count() / 1000;
+	timespec.tv_nsec = (timeout.count() % 1000) * 1000000;
+
+	struct io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	arg.sigmask_sz = _NSIG / 8;
+	arg.ts = (uint64_t) (uintptr_t) &timespec;
+
+	int result = this->_enter(this->_unsubmitted, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+	if (result > 0) this->_unsubmitted -= std::min<unsigned>(result, this->_unsubmitted);
+	// Only returned when nothing needed submitting, so there is nothing left to account for.
+	if (result == -ETIME || result == -EINTR) return 0;
+	return result;
+}
+
+bool IoUring::next(uring_completion_t &completion)
+{
+	unsigned head = *this->_cq_head;
+	if (head == __atomic_load_n(this->_cq_tail, __ATOMIC_ACQUIRE)) return false;
+
+	const struct io_uring_cqe &cqe = this->_cqes[head & this->_cq_mask];
+	completion.user_data = cqe.user_data;
+	completion.result = cqe.res;
+	completion.more = cqe.flags & IORING_CQE_F_MORE;
+	completion.has_buffer = cqe.flags & IORING_CQE_F_BUFFER;
+	completion.buffer = (uint16_t) (cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+	__atomic_store_n(this->_cq_head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+void IoUring::recycle(uint16_t id)
+{
+	struct io_uring_buf *ring = (struct io_uring_buf *) this->_buffer_ring;
+	struct io_uring_buf &entry = ring[this->_buffer_tail & (this->_buffer_count - 1)];
+	entry.addr = (uint64_t) (uintptr_t) (this->_buffers + (size_t) id * this->_buffer_size);
+	entry.len = this->_buffer_size;
+	entry.bid = id;
+	this->_buffer_tail++;
+	// The tail shares its place with the reserved field of the first entry.
+	__atomic_store_n(&ring[0].resv, this->_buffer_tail, __ATOMIC_RELEASE);
+}
+
+#else
+
+// Without io_uring support, the ring never becomes ready and nothing else is ever called.
+
+IoUring::IoUring(unsigned, unsigned, size_t):
+	_error("io_uring support was not compiled in. Configure with -DCPP_RCON_IO_URING=ON.")
+{}
+
+IoUring::~IoUring() {}
+
+void IoUring::_release() {}
+
+bool IoUring::poll(uint64_t, int, uint32_t, bool) { return false; }
+bool IoUring::receive(uint64_t, int, bool) { return false; }
+bool IoUring::send(uint64_t, int, const char *, size_t) { return false; }
+bool IoUring::cancel(uint64_t, uint64_t) { return false; }
+int IoUring::submit() { return 0; }
+int IoUring::submit_and_wait(std::chrono::milliseconds) { return 0; }
+bool IoUring::next(uring_completion_t &) { return false; }
+void IoUring::recycle(uint16_t) {}
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef _CPP_RCON_TEST_CHECK_
+#define _CPP_RCON_TEST_CHECK_
+
+#include <iostream>
+
+/**
+ * @brief The number of checks that have failed so far. Test programs return non-zero if there were any.
+ */
+inline int check_failures = 0;
+
+/**
+ * @def CHECK
+ * @brief Reports the condition along with its location if it doesn't hold, and carries on.
+ */
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+			check_failures++; \
+		} \
+	} while (0)
+
+/**
+ * @def CHECK_EQ
+ * @brief Same as @ref CHECK, but also reports both values if they differ.
+ */
+#define CHECK_EQ(actual, expected) \
+	do { \
+		auto &&_actual = (actual); \
+		auto &&_expected = (expected); \
+		if (!(_actual == _expected)) \
+		{ \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_EQ(" #actual ", " #expected ") failed: " << _actual << " != " << _expected << std::endl; \
+			check_failures++; \
+		} \
+	} while (0)
+
+#endif // _CPP_RCON_TEST_CHECK_
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "mpsc_queue.hpp"
+
+namespace
+{
+	constexpr uint64_t PRODUCERS = 8;
+	constexpr uint64_t VALUES_PER_PRODUCER = 200000;
+
+	void test_single_thread()
+	{
+		MpscQueue<int> queue;
+		int value = -1;
+		CHECK(!queue.pop(value));
+		for (int i = 0; i < 10; i++) queue.push(i);
+		for (int i = 0; i < 10; i++)
+		{
+			CHECK(queue.pop(value));
+			CHECK_EQ(value, i);
+		}
+		CHECK(!queue.pop(value));
+
+		// The queue keeps working after it has been drained.
+		queue.push(42);
+		CHECK(queue.pop(value));
+		CHECK_EQ(value, 42);
+	}
+
+	void test_concurrent_producers()
+	{
+		// Each value carries its producer in the top bits and its position in the bottom ones.
+		MpscQueue<uint64_t> queue;
+		std::atomic<bool> go{false};
+		std::vector<std::thread> producers;
+		for (uint64_t producer = 0; producer < PRODUCERS; producer++)
+		{
+			producers.emplace_back([&, producer] {
+				while (!go.load(std::memory_order_acquire)) {}
+				for (uint64_t i = 0; i < VALUES_PER_PRODUCER; i++) queue.push(producer << 32 | i);
+			});
+		}
+
+		// The consumer pops while the producers are still pushing.
+		go.store(true, std::memory_order_release);
+		std::vector<uint64_t> next_expected(PRODUCERS, 0);
+		uint64_t received = 0;
+		uint64_t out_of_order = 0;
+		uint64_t unknown = 0;
+		while (received < PRODUCERS * VALUES_PER_PRODUCER)
+		{
+			uint64_t value;
+			if (!queue.pop(value))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			received++;
+			uint64_t producer = value >> 32;
+			if (producer >= PRODUCERS)
+			{
+				unknown++;
+				continue;
+			}
+			// Values from the same producer come out in the order they were pushed, with none skipped or repeated.
+			if ((value & 0xFFFFFFFF) != next_expected[producer]) out_of_order++;
+			next_expected[producer] = (value & 0xFFFFFFFF) + 1;
+		}
+		for (std::thread &producer : producers) producer.join();
+
+		CHECK_EQ(unknown, 0u);
+		CHECK_EQ(out_of_order, 0u);
+		for (uint64_t producer = 0; producer < PRODUCERS; producer++) CHECK_EQ(next_expected[producer], VALUES_PER_PRODUCER);
+		uint64_t value;
+		CHECK(!queue.pop(value));
+	}
+
+	void test_destroys_remaining_values()
+	{
+		auto tracked = std::make_shared<int>(0);
+		{
+			MpscQueue<std::shared_ptr<int>> queue;
+			for (int i = 0; i < 100; i++) queue.push(tracked);
+			std::shared_ptr<int> value;
+			CHECK(queue.pop(value));
+		}
+		CHECK_EQ(tracked.use_count(), 1);
+	}
+}
+
+int main()
+{
+	test_single_thread();
+	test_concurrent_producers();
+	test_destroys_remaining_values();
+	return check_failures == 0 ? 0 : 1;
+}
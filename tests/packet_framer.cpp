@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "packet.hpp"
+
+namespace
+{
+	typedef struct
+	{
+		int32_t id;
+		int32_t type;
+		std::string body;
+	} decoded_t;
+
+	/// Feeds `data` to the framer in pieces of at most `piece` bytes, and collects every packet that comes out.
+	std::vector<decoded_t> feed(PacketFramer &framer, std::string_view data, size_t piece)
+	{
+		std::vector<decoded_t> packets;
+		while (!data.empty())
+		{
+			size_t available;
+			char *buffer = framer.prepare(available);
+			size_t count = std::min({available, piece, data.size()});
+			std::memcpy(buffer, data.data(), count);
+			framer.commit(count);
+			data.remove_prefix(count);
+
+			// Bodies only stay valid until the next call to prepare, so they are copied out straight away.
+			rcon_packet_t packet;
+			while (framer.next(packet)) packets.push_back({packet.id, packet.type, std::string(packet.body)});
+		}
+		return packets;
+	}
+
+	std::string raw_size(int32_t size)
+	{
+		std::string data(sizeof(size), '\0');
+		std::memcpy(data.data(), &size, sizeof(size));
+		return data;
+	}
+
+	void test_single_packet()
+	{
+		std::string data;
+		append_packet(data, 7, 2, "status");
+		CHECK_EQ(data.size(), encoded_packet_size(6));
+
+		PacketFramer framer;
+		std::vector<decoded_t> packets = feed(framer, data, data.size());
+		CHECK_EQ(packets.size(), 1u);
+		if (packets.size() != 1) return;
+		CHECK_EQ(packets[0].id, 7);
+		CHECK_EQ(packets[0].type, 2);
+		CHECK_EQ(packets[0].body, "status");
+		CHECK_EQ(framer.buffered(), 0u);
+	}
+
+	void test_split_frames()
+	{
+		std::string data;
+		append_packet(data, 1, 0, "first");
+		append_packet(data, 2, 0, "");
+		append_packet(data, 3, 0, std::string(MAX_BODY_LENGTH, 'x'));
+
+		// Every possible split point, including splits inside the size field, has to give the same packets.
+		for (size_t piece : {1, 2, 3, 5, 13, 4095, 4096, 4097})
+		{
+			PacketFramer framer;
+			std::vector<decoded_t> packets = feed(framer, data, piece);
+			CHECK_EQ(packets.size(), 3u);
+			if (packets.size() != 3) continue;
+			CHECK_EQ(packets[0].body, "first");
+			CHECK_EQ(packets[1].id, 2);
+			CHECK_EQ(packets[1].body, "");
+			CHECK_EQ(packets[2].body, std::string(MAX_BODY_LENGTH, 'x'));
+			CHECK(!framer.is_corrupt());
+		}
+	}
+
+	void test_coalesced_frames()
+	{
+		std::string data;
+		for (int32_t id = 0; id < 1000; id++) append_packet(data, id, 0, std::string(id % 50, 'a' + id % 26));
+
+		PacketFramer framer(64);
+		std::vector<decoded_t> packets = feed(framer, data, data.size());
+		CHECK_EQ(packets.size(), 1000u);
+		for (size_t i = 0; i < packets.size(); i++)
+		{
+			CHECK_EQ(packets[i].id, (int32_t) i);
+			CHECK_EQ(packets[i].body, std::string(i % 50, 'a' + i % 26));
+		}
+		CHECK_EQ(framer.buffered(), 0u);
+	}
+
+	void test_oversized_frame()
+	{
+		// Larger than the initial buffer and than MAX_PACKET_LENGTH, but still within the frame limit.
+		std::string body(MAX_PACKET_LENGTH * 3, 'z');
+		std::string data;
+		append_packet(data, 9, 0, body);
+		append_packet(data, 10, 0, "after");
+
+		PacketFramer framer(16);
+		std::vector<decoded_t> packets = feed(framer, data, 1000);
+		CHECK_EQ(packets.size(), 2u);
+		if (packets.size() != 2) return;
+		CHECK_EQ(packets[0].body, body);
+		CHECK_EQ(packets[1].body, "after");
+	}
+
+	void test_corrupt_length()
+	{
+		// Too small to even hold the ID, the type and the terminators.
+		{
+			PacketFramer framer;
+			std::vector<decoded_t> packets = feed(framer, raw_size(PACKET_PADDING_SIZE - 1) + std::string(16, '\0'), 64);
+			CHECK(packets.empty());
+			CHECK(framer.is_corrupt());
+		}
+		// Negative.
+		{
+			PacketFramer framer;
+			feed(framer, raw_size(-1) + std::string(16, '\0'), 64);
+			CHECK(framer.is_corrupt());
+		}
+		// Larger than the frame limit. Nothing after it is handed out, even if it looks like a packet.
+		{
+			std::string data;
+			append_packet(data, 1, 0, "before");
+			data += raw_size(1024 + 1);
+			append_packet(data, 2, 0, "after");
+
+			PacketFramer framer(MAX_PACKET_LENGTH, 1024);
+			std::vector<decoded_t> packets = feed(framer, data, data.size());
+			CHECK_EQ(packets.size(), 1u);
+			CHECK(framer.is_corrupt());
+
+			rcon_packet_t packet;
+			CHECK(!framer.next(packet));
+
+			// A reset starts over on a fresh stream.
+			framer.reset();
+			CHECK(!framer.is_corrupt());
+			std::string fresh;
+			append_packet(fresh, 3, 0, "fresh");
+			packets = feed(framer, fresh, fresh.size());
+			CHECK_EQ(packets.size(), 1u);
+		}
+		// The largest accepted frame is still fine.
+		{
+			std::string data;
+			append_packet(data, 1, 0, std::string(1024 - (PACKET_PADDING_SIZE), 'm'));
+			PacketFramer framer(MAX_PACKET_LENGTH, 1024);
+			CHECK_EQ(feed(framer, data, 7).size(), 1u);
+			CHECK(!framer.is_corrupt());
+		}
+	}
+}
+
+int main()
+{
+	test_single_packet();
+	test_split_frames();
+	test_coalesced_frames();
+	test_oversized_frame();
+	test_corrupt_length();
+	return check_failures == 0 ? 0 : 1;
+}
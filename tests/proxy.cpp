@@ -0,0 +1,111 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "mock_server.hpp"
+#include "proxy.hpp"
+#include "raw_client.hpp"
+#include "reactor.hpp"
+
+namespace
+{
+	constexpr size_t COMMANDS_PER_CLIENT = 61;
+	/// Both clients use the same IDs, so that responses can only be told apart by the connection they belong to.
+	constexpr int32_t FIRST_ID = 1000;
+
+	/// Every 7th command asks for a response that spans several packets, and every 5th one is answered late.
+	std::string command_for(char client, size_t index)
+	{
+		if (index % 7 == 3) return "bytes " + std::to_string(MAX_BODY_LENGTH * 2 + index);
+		if (index % 5 == 1) return "sleep 5";
+		return std::string("echo ") + client + std::to_string(index);
+	}
+
+	std::string expected_for(char client, size_t index)
+	{
+		if (index % 7 == 3) return std::string(MAX_BODY_LENGTH * 2 + index, 'x');
+		if (index % 5 == 1) return "";
+		return std::string(1, client) + std::to_string(index);
+	}
+
+	/// Checks that a client got exactly its own responses, each under the ID of its command and in order.
+	void check_responses(char client, const std::vector<raw_packet_t> &packets)
+	{
+		std::vector<std::string> responses(COMMANDS_PER_CLIENT);
+		int32_t last_id = FIRST_ID;
+		size_t out_of_order = 0;
+		size_t unknown = 0;
+		for (const raw_packet_t &packet : packets)
+		{
+			if (packet.id < FIRST_ID || packet.id >= FIRST_ID + (int32_t) COMMANDS_PER_CLIENT || packet.type != RESPONSE_VALUE)
+			{
+				unknown++;
+				continue;
+			}
+			if (packet.id < last_id) out_of_order++;
+			last_id = packet.id;
+			responses[packet.id - FIRST_ID] += packet.body;
+		}
+		CHECK_EQ(unknown, 0u);
+		CHECK_EQ(out_of_order, 0u);
+
+		size_t mismatched = 0;
+		for (size_t i = 0; i < COMMANDS_PER_CLIENT; i++)
+		{
+			if (responses[i] != expected_for(client, i)) mismatched++;
+		}
+		CHECK_EQ(mismatched, 0u);
+	}
+
+	void test_routing()
+	{
+		MockRconServer upstream;
+		CHECK(upstream.start());
+
+		RconReactor reactor;
+		RconProxy proxy(reactor, {"127.0.0.1", upstream.port()}, "password", "proxy");
+		proxy.set_log_level(LOG_LEVEL::ERROR);
+		CHECK(proxy.listen(0));
+		std::atomic<bool> running{true};
+		std::thread loop([&] {
+			while (running) reactor.run_once(std::chrono::milliseconds(20));
+		});
+
+		RawClient a(proxy.port());
+		RawClient b(proxy.port());
+		CHECK(a.authenticate("proxy"));
+		CHECK(b.authenticate("proxy"));
+
+		// The commands of both clients interleave on the single upstream session.
+		for (size_t i = 0; i < COMMANDS_PER_CLIENT; i++)
+		{
+			CHECK(a.send(FIRST_ID + (int32_t) i, EXECCOMMAND, command_for('a', i)));
+			CHECK(b.send(FIRST_ID + (int32_t) i, EXECCOMMAND, command_for('b', i)));
+		}
+
+		// The last command of each client is a plain echo, so its only packet marks the end of the responses.
+		std::vector<raw_packet_t> a_packets;
+		std::vector<raw_packet_t> b_packets;
+		CHECK(a.receive(a_packets, FIRST_ID + (int32_t) COMMANDS_PER_CLIENT - 1));
+		CHECK(b.receive(b_packets, FIRST_ID + (int32_t) COMMANDS_PER_CLIENT - 1));
+		check_responses('a', a_packets);
+		check_responses('b', b_packets);
+
+		// A client with the wrong password doesn't get through to the upstream server.
+		RawClient intruder(proxy.port());
+		CHECK(!intruder.authenticate("password"));
+
+		running = false;
+		loop.join();
+	}
+}
+
+int main()
+{
+	static_assert((COMMANDS_PER_CLIENT - 1) % 7 != 3 && (COMMANDS_PER_CLIENT - 1) % 5 != 1, "the last command has to be an echo");
+	test_routing();
+	return check_failures == 0 ? 0 : 1;
+}
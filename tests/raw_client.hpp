@@ -0,0 +1,110 @@
+#pragma once
+#ifndef _CPP_RCON_TEST_RAW_CLIENT_
+#define _CPP_RCON_TEST_RAW_CLIENT_
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "packet.hpp"
+
+constexpr int32_t EXECCOMMAND = 2;
+constexpr int32_t AUTH = 3;
+constexpr int32_t RESPONSE_VALUE = 0;
+constexpr int32_t AUTH_RESPONSE = 2;
+
+typedef struct
+{
+	int32_t id;
+	int32_t type;
+	std::string body;
+} raw_packet_t;
+
+/**
+ * @brief A client that speaks the protocol by hand, so that the packets themselves can be checked.
+ */
+class RawClient
+{
+private:
+	int _socket = -1;
+	PacketFramer _framer;
+
+public:
+	RawClient(uint16_t port)
+	{
+		this->_socket = ::socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+		if (::connect(this->_socket, (sockaddr *) &address, sizeof(address)) < 0) this->close();
+	}
+	~RawClient() { this->close(); }
+
+	void close()
+	{
+		if (this->_socket >= 0) ::close(this->_socket);
+		this->_socket = -1;
+	}
+
+	int socket() const { return this->_socket; }
+
+	bool send(int32_t id, int32_t type, std::string_view body)
+	{
+		std::string data;
+		append_packet(data, id, type, body);
+		return ::send(this->_socket, data.data(), data.size(), MSG_NOSIGNAL) == (ssize_t) data.size();
+	}
+
+	/**
+	 * @brief Authenticates under the packet ID 1.
+	 * @returns Whether the password was accepted.
+	 */
+	bool authenticate(std::string_view password)
+	{
+		std::vector<raw_packet_t> packets;
+		if (!this->send(1, AUTH, password)) return false;
+		while (packets.empty() || packets.back().type != AUTH_RESPONSE)
+		{
+			size_t received = packets.size();
+			this->receive(packets, 1);
+			if (packets.size() == received) return false;
+		}
+		return packets.back().id == 1;
+	}
+
+	/**
+	 * @brief Reads until a packet with the ID `until` has arrived, the server hangs up, or nothing arrives for a while.
+	 * @returns False if the server hung up.
+	 */
+	bool receive(std::vector<raw_packet_t> &packets, int32_t until)
+	{
+		while (true)
+		{
+			rcon_packet_t packet;
+			while (this->_framer.next(packet))
+			{
+				packets.push_back({packet.id, packet.type, std::string(packet.body)});
+				if (packet.id == until) return true;
+			}
+
+			struct pollfd poll_fd = {this->_socket, POLLIN, 0};
+			if (::poll(&poll_fd, 1, 5000) <= 0) return true;
+			size_t available;
+			char *buffer = this->_framer.prepare(available);
+			ssize_t received = ::recv(this->_socket, buffer, available, 0);
+			if (received <= 0) return false;
+			this->_framer.commit(received);
+		}
+	}
+};
+
+#endif // _CPP_RCON_TEST_RAW_CLIENT_
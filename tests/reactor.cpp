@@ -0,0 +1,103 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "mock_server.hpp"
+#include "reactor.hpp"
+
+namespace
+{
+	constexpr size_t SESSIONS = 4;
+	constexpr size_t COMMANDS_PER_SESSION = 300;
+
+	/// Every third command asks for a response that spans several packets.
+	std::string command_for(size_t session, size_t index)
+	{
+		if (index % 3 == 2) return "bytes " + std::to_string(MAX_PACKET_LENGTH * (1 + index % 4) + session);
+		return "echo " + std::to_string(session) + ":" + std::to_string(index);
+	}
+
+	std::string expected_for(size_t session, size_t index)
+	{
+		if (index % 3 == 2) return std::string(MAX_PACKET_LENGTH * (1 + index % 4) + session, 'x');
+		return std::to_string(session) + ":" + std::to_string(index);
+	}
+
+	void test_round_trip(REACTOR_BACKEND backend, const char *name, mock_config_t config)
+	{
+		MockRconServer mock(config);
+		CHECK(mock.start());
+
+		RconReactor reactor(64, backend);
+		if (reactor.backend() != backend)
+		{
+			std::cout << name << " isn't available here, skipping it." << std::endl;
+			return;
+		}
+
+		std::vector<std::unique_ptr<Rcon>> sessions;
+		size_t ready = 0;
+		size_t failed = 0;
+		size_t completed = 0;
+		size_t mismatched = 0;
+		for (size_t i = 0; i < SESSIONS; i++)
+		{
+			sessions.push_back(std::make_unique<Rcon>(rcon_addr_t{"127.0.0.1", mock.port()}));
+			sessions.back()->set_log_level(LOG_LEVEL::WARNING);
+			CHECK(reactor.add_session(*sessions.back(), "password", [&](Rcon &, bool success) {
+				if (success) ready++;
+				else failed++;
+			}));
+		}
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (ready + failed < SESSIONS && std::chrono::steady_clock::now() < deadline) reactor.run_once(std::chrono::milliseconds(100));
+		CHECK_EQ(ready, SESSIONS);
+
+		// Everything is queued up front, so the commands of all sessions are pipelined together.
+		for (size_t session = 0; session < SESSIONS; session++)
+		{
+			for (size_t index = 0; index < COMMANDS_PER_SESSION; index++)
+			{
+				sessions[session]->send_command_async(command_for(session, index), [&, session, index](bool success, std::string response) {
+					completed++;
+					if (!success || response != expected_for(session, index)) mismatched++;
+				});
+			}
+		}
+		while (completed < SESSIONS * COMMANDS_PER_SESSION && std::chrono::steady_clock::now() < deadline) reactor.run_once(std::chrono::milliseconds(100));
+		CHECK_EQ(completed, SESSIONS * COMMANDS_PER_SESSION);
+		CHECK_EQ(mismatched, 0u);
+
+		for (auto &session : sessions)
+		{
+			reactor.remove_session(*session);
+			session->close();
+		}
+		CHECK_EQ(reactor.size(), 0u);
+	}
+
+	void test_backend(REACTOR_BACKEND backend, const char *name)
+	{
+		// Sentinels are answered the way Source servers answer them, trailer packet included.
+		mock_config_t source;
+		source.source_trailer = true;
+		test_round_trip(backend, name, source);
+
+		// Packets that arrive in small pieces, each in its own write.
+		mock_config_t fragmented;
+		fragmented.fragment_size = 7;
+		fragmented.coalesce = false;
+		test_round_trip(backend, name, fragmented);
+	}
+}
+
+int main()
+{
+	test_backend(REACTOR_BACKEND::EPOLL, "epoll");
+	test_backend(REACTOR_BACKEND::IO_URING, "io_uring");
+	return check_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "check.hpp"
+#include "libindex.hpp"
+#include "packet.hpp"
+#include "raw_client.hpp"
+#include "reactor.hpp"
+#include "server.hpp"
+
+namespace
+{
+	/// A body whose every chunk is different, so that misplaced or dropped chunks show up.
+	std::string make_body(size_t length)
+	{
+		std::string body(length, '\0');
+		for (size_t i = 0; i < length; i++) body[i] = (char) ('a' + (i / 7) % 26);
+		return body;
+	}
+
+	/**
+	 * @brief Runs an @ref RconServer on a thread of its own, answering commands like this:
+	 * - `bytes N` answers with N bytes from @ref make_body.
+	 * - `defer TEXT` is held back until `release`, which answers every held command with its TEXT, newest first, and
+	 *   then itself with `released`.
+	 * - Anything else is echoed back.
+	 */
+	class TestServer
+	{
+	private:
+		RconReactor _reactor;
+		RconServer _server;
+		std::vector<std::pair<RconServer::Responder, std::string>> _deferred;
+		std::atomic<bool> _running{true};
+		std::thread _thread;
+
+	public:
+		std::atomic<size_t> handled{0};
+
+		TestServer(size_t max_commands, size_t max_bytes) : _server(_reactor, "password")
+		{
+			this->_server.set_log_level(LOG_LEVEL::ERROR);
+			this->_server.set_client_limits(max_commands, max_bytes);
+			this->_server.on_command([this](std::string_view command, RconServer::Responder respond) {
+				this->handled++;
+				if (command.substr(0, 6) == "bytes ")
+				{
+					respond(make_body(strtoul(std::string(command.substr(6)).c_str(), nullptr, 10)));
+				}
+				else if (command.substr(0, 6) == "defer ")
+				{
+					this->_deferred.emplace_back(respond, std::string(command.substr(6)));
+				}
+				else if (command == "release")
+				{
+					for (auto deferred = this->_deferred.rbegin(); deferred != this->_deferred.rend(); ++deferred) deferred->first(deferred->second);
+					this->_deferred.clear();
+					respond("released");
+				}
+				else
+				{
+					respond(command);
+				}
+			});
+			CHECK(this->_server.listen(0, "127.0.0.1"));
+			this->_thread = std::thread([this] {
+				while (this->_running) this->_reactor.run_once(std::chrono::milliseconds(20));
+			});
+		}
+
+		~TestServer()
+		{
+			this->_running = false;
+			this->_thread.join();
+		}
+
+		uint16_t port() const { return this->_server.port(); }
+	};
+
+	void test_chunking(TestServer &server)
+	{
+		RawClient client(server.port());
+		CHECK(client.socket() >= 0);
+		std::vector<raw_packet_t> packets;
+		CHECK(client.send(1, AUTH, "password"));
+		CHECK(client.receive(packets, 1));
+		CHECK(client.receive(packets, 1));
+		CHECK_EQ(packets.size(), 2u);
+		if (packets.size() == 2) CHECK_EQ(packets[1].type, AUTH_RESPONSE);
+
+		// The length of each response, and the number of packets it has to be split into.
+		std::vector<std::pair<size_t, size_t>> cases = {
+			{0, 1},
+			{MAX_BODY_LENGTH, 1},
+			{MAX_BODY_LENGTH + 1, 2},
+			{3 * MAX_BODY_LENGTH + 7, 4},
+		};
+		int32_t id = 10;
+		for (auto [length, expected_packets] : cases)
+		{
+			CHECK(client.send(id, EXECCOMMAND, "bytes " + std::to_string(length)));
+			// The sentinel marks the end of the response.
+			CHECK(client.send(id + 1, RESPONSE_VALUE, ""));
+			packets.clear();
+			CHECK(client.receive(packets, id + 1));
+
+			std::string body;
+			size_t count = 0;
+			for (const raw_packet_t &packet : packets)
+			{
+				if (packet.id != id) continue;
+				count++;
+				CHECK_EQ(packet.type, RESPONSE_VALUE);
+				// The limit applies to the size field, which doesn't count itself.
+				CHECK(packet.body.size() + PACKET_PADDING_SIZE <= MAX_PACKET_LENGTH);
+				body += packet.body;
+			}
+			CHECK_EQ(count, expected_packets);
+			CHECK_EQ(body.size(), length);
+			CHECK(body == make_body(length));
+			CHECK(!packets.empty() && packets.back().id == id + 1 && packets.back().body.empty());
+			id += 2;
+		}
+	}
+
+	void test_session_round_trip(TestServer &server)
+	{
+		Rcon session({"127.0.0.1", server.port()});
+		session.set_log_level(LOG_LEVEL::ERROR);
+		session.connect();
+		std::string password = "password";
+		CHECK(session.authenticate(password));
+
+		CHECK(session.send_command("bytes " + std::to_string(3 * MAX_BODY_LENGTH + 7)) == make_body(3 * MAX_BODY_LENGTH + 7));
+
+		// Responses given out of order still reach the client in the order of its commands.
+		std::vector<std::string> responses;
+		for (std::string command : {"defer 1", "defer 2", "echo", "defer 3", "release"})
+		{
+			session.send_command_async(command, [&responses](bool success, std::string response) {
+				responses.push_back(success ? response : "<failed>");
+			});
+		}
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (session.pending_commands() > 0 && std::chrono::steady_clock::now() < deadline) session.poll(std::chrono::milliseconds(100));
+		CHECK((responses == std::vector<std::string>{"1", "2", "echo", "3", "released"}));
+		session.close();
+	}
+
+	void test_wrong_password(TestServer &server)
+	{
+		RawClient client(server.port());
+		std::vector<raw_packet_t> packets;
+		CHECK(client.send(1, AUTH, "wrong"));
+		CHECK(client.receive(packets, -1));
+		CHECK(!packets.empty() && packets.back().type == AUTH_RESPONSE);
+
+		// The client is disconnected straight after, so it can't keep guessing.
+		bool hung_up = !client.receive(packets, 1000);
+		CHECK(hung_up);
+
+		Rcon session({"127.0.0.1", server.port()});
+		session.set_log_level(LOG_LEVEL::FATAL);
+		session.connect();
+		std::string password = "wrong";
+		CHECK(!session.authenticate(password));
+		session.close();
+	}
+
+	void test_backpressure(TestServer &server, size_t max_commands)
+	{
+		constexpr size_t COMMANDS = 20000;
+		constexpr size_t RESPONSE_LENGTH = 4000;
+
+		RawClient client(server.port());
+		std::vector<raw_packet_t> packets;
+		CHECK(client.send(1, AUTH, "password"));
+		CHECK(client.receive(packets, 1));
+		CHECK(client.receive(packets, 1));
+
+		// Far more responses than the socket buffers can hold are requested without reading any of them.
+		std::string requests;
+		for (size_t i = 0; i < COMMANDS; i++) append_packet(requests, (int32_t) (10 + i), EXECCOMMAND, "bytes " + std::to_string(RESPONSE_LENGTH));
+		fcntl(client.socket(), F_SETFL, fcntl(client.socket(), F_GETFL) | O_NONBLOCK);
+		size_t written = 0;
+		auto write_some = [&] {
+			while (written < requests.size())
+			{
+				ssize_t sent = ::send(client.socket(), requests.data() + written, requests.size() - written, MSG_NOSIGNAL);
+				if (sent <= 0) break;
+				written += sent;
+			}
+		};
+		write_some();
+
+		// The server stops taking commands once the client is over its limits, instead of buffering every response.
+		std::this_thread::sleep_for(std::chrono::milliseconds(300));
+		size_t handled = server.handled;
+		std::this_thread::sleep_for(std::chrono::milliseconds(300));
+		CHECK_EQ((size_t) server.handled, handled);
+		CHECK(handled < COMMANDS / 2);
+		CHECK(handled >= max_commands);
+
+		// Once the client reads, the server picks up where it left off and every command is answered in order.
+		PacketFramer framer;
+		size_t answered = 0;
+		size_t out_of_order = 0;
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+		while (answered < COMMANDS && std::chrono::steady_clock::now() < deadline)
+		{
+			write_some();
+			struct pollfd poll_fd = {client.socket(), (short) (POLLIN | (written < requests.size() ? POLLOUT : 0)), 0};
+			::poll(&poll_fd, 1, 1000);
+			if (!(poll_fd.revents & POLLIN)) continue;
+
+			size_t available;
+			char *buffer = framer.prepare(available);
+			ssize_t received = ::recv(client.socket(), buffer, available, 0);
+			if (received <= 0) break;
+			framer.commit(received);
+			rcon_packet_t packet;
+			while (framer.next(packet))
+			{
+				if (packet.id != (int32_t) (10 + answered) || packet.body.size() != RESPONSE_LENGTH) out_of_order++;
+				answered++;
+			}
+		}
+		CHECK_EQ(answered, COMMANDS);
+		CHECK_EQ(out_of_order, 0u);
+	}
+}
+
+int main()
+{
+	constexpr size_t MAX_COMMANDS = 16;
+	TestServer server(MAX_COMMANDS, 64 * 1024);
+	test_chunking(server);
+	test_session_round_trip(server);
+	test_wrong_password(server);
+	test_backpressure(server, MAX_COMMANDS);
+	return check_failures == 0 ? 0 : 1;
+}
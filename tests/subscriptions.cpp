@@ -0,0 +1,62 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "libindex.hpp"
+#include "mock_server.hpp"
+
+namespace
+{
+	constexpr size_t COMMANDS = 200;
+
+	void test_source_trailer_is_not_an_event()
+	{
+		// The mock answers every sentinel with its mirror and the trailer packet that Source servers send after it.
+		mock_config_t config;
+		config.source_trailer = true;
+		MockRconServer mock(config);
+		CHECK(mock.start());
+
+		Rcon session({"127.0.0.1", mock.port()});
+		session.set_log_level(LOG_LEVEL::WARNING);
+		session.connect();
+		std::string password = "password";
+		CHECK(session.authenticate(password));
+
+		std::vector<std::string> events;
+		session.subscribe([&events](const rcon_packet_t &packet) { events.emplace_back(packet.body); });
+
+		size_t succeeded = 0;
+		for (size_t i = 0; i < COMMANDS; i++)
+		{
+			session.send_command_async("echo " + std::to_string(i), [&succeeded, i](bool success, std::string response) {
+				if (success && response == std::to_string(i)) succeeded++;
+			});
+		}
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (session.pending_commands() > 0 && std::chrono::steady_clock::now() < deadline) session.poll(std::chrono::milliseconds(100));
+		CHECK_EQ(succeeded, COMMANDS);
+
+		// The blocking path waits for the sentinel as well.
+		CHECK_EQ(session.send_command("echo blocking"), "blocking");
+
+		// Give the last trailers time to arrive before checking that none of them got through.
+		session.poll(std::chrono::milliseconds(100));
+		CHECK_EQ(events.size(), 0u);
+		CHECK(session.get_pending_data().empty());
+
+		// Packets the server pushes on its own still reach the subscriber.
+		session.send_command("push 3");
+		session.poll(std::chrono::milliseconds(100));
+		CHECK_EQ(events.size(), 3u);
+
+		session.close();
+	}
+}
+
+int main()
+{
+	test_source_trailer_is_not_an_event();
+	return check_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "check.hpp"
+#include "timer_wheel.hpp"
+
+namespace
+{
+	/// An item that remembers the tick it came up on.
+	typedef struct
+	{
+		uint64_t due;
+		uint64_t fired_at;
+		unsigned times_fired;
+	} countdown_t;
+
+	using Wheel = TimerWheel<countdown_t>;
+
+	void advance(Wheel &wheel, uint64_t target)
+	{
+		wheel.advance(target, [&wheel](std::shared_ptr<countdown_t> timer) {
+			timer->fired_at = wheel.now();
+			timer->times_fired++;
+		});
+	}
+
+	std::shared_ptr<countdown_t> add(Wheel &wheel, uint64_t due)
+	{
+		auto timer = std::make_shared<countdown_t>(countdown_t{due, 0, 0});
+		wheel.insert(timer, due);
+		return timer;
+	}
+
+	/// The first tick of each level, where items start having to cascade down.
+	const std::vector<uint64_t> LEVEL_STARTS = {
+		1ULL << Wheel::LEVEL0_BITS,
+		1ULL << (Wheel::LEVEL0_BITS + Wheel::LEVEL_BITS),
+		1ULL << (Wheel::LEVEL0_BITS + 2 * Wheel::LEVEL_BITS),
+	};
+
+	void test_cascade_across_levels(uint64_t start)
+	{
+		Wheel wheel;
+		advance(wheel, start);
+
+		std::vector<std::shared_ptr<countdown_t>> timers;
+		for (uint64_t boundary : LEVEL_STARTS)
+		{
+			for (uint64_t offset : {boundary - 1, boundary, boundary + 1, 2 * boundary - 1, 2 * boundary + 3})
+			{
+				timers.push_back(add(wheel, start + offset));
+			}
+		}
+		// Beyond the span of the wheel, which has it filed again as it comes up too early.
+		timers.push_back(add(wheel, start + Wheel::SPAN + 300));
+
+		advance(wheel, start + Wheel::SPAN + 1000);
+		for (const auto &timer : timers)
+		{
+			CHECK_EQ(timer->times_fired, 1u);
+			CHECK_EQ(timer->fired_at, timer->due);
+		}
+	}
+
+	void test_cancel_across_levels()
+	{
+		Wheel wheel;
+		unsigned fired = 0;
+		auto count = [&fired](std::shared_ptr<countdown_t>) { fired++; };
+
+		std::vector<std::shared_ptr<countdown_t>> kept;
+		for (uint64_t boundary : LEVEL_STARTS)
+		{
+			uint64_t due = boundary + 5;
+			kept.push_back(add(wheel, due));
+			// One is cancelled while it still sits in a higher level, the other once it has cascaded down to the first.
+			std::shared_ptr<countdown_t> early = add(wheel, due);
+			std::shared_ptr<countdown_t> late = add(wheel, due);
+			early.reset();
+			wheel.advance(due - 10, count);
+			late.reset();
+		}
+		wheel.advance(LEVEL_STARTS.back() * 2, count);
+		CHECK_EQ(fired, (unsigned) kept.size());
+	}
+
+	void test_overdue()
+	{
+		Wheel wheel;
+		advance(wheel, 1000);
+		auto overdue = add(wheel, 10);
+		auto now = add(wheel, 1000);
+		CHECK_EQ(wheel.next_tick(), 1001u);
+		advance(wheel, 1001);
+		CHECK_EQ(overdue->fired_at, 1001u);
+		CHECK_EQ(now->fired_at, 1001u);
+	}
+
+	void test_next_tick()
+	{
+		Wheel wheel;
+		// With nothing to do, the wheel still has to come back when the first level wraps around.
+		CHECK_EQ(wheel.next_tick(), 1ULL << Wheel::LEVEL0_BITS);
+		auto soon = add(wheel, 5);
+		CHECK_EQ(wheel.next_tick(), 5u);
+		auto later = add(wheel, 1000);
+		advance(wheel, 5);
+		CHECK_EQ(wheel.next_tick(), 1ULL << Wheel::LEVEL0_BITS);
+		advance(wheel, 1ULL << Wheel::LEVEL0_BITS);
+		CHECK_EQ(wheel.next_tick(), 2ULL << Wheel::LEVEL0_BITS);
+		// Once its slot in the second level comes up, the later one is moved down into the first.
+		advance(wheel, 3ULL << Wheel::LEVEL0_BITS);
+		CHECK_EQ(wheel.next_tick(), 1000u);
+		advance(wheel, 1000);
+		CHECK_EQ(soon->times_fired, 1u);
+		CHECK_EQ(later->times_fired, 1u);
+	}
+}
+
+int main()
+{
+	test_cascade_across_levels(0);
+	// Starting partway through every level, so that items straddle the point where each one wraps around.
+	test_cascade_across_levels((1ULL << 20) + (1ULL << 14) * 3 + (1ULL << 8) * 5 + 77);
+	test_cancel_across_levels();
+	test_overdue();
+	test_next_tick();
+	return check_failures == 0 ? 0 : 1;
+}